@@ -0,0 +1,327 @@
+//
+// Created by bruno on 24/01/18.
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+#include "lecture1.h"
+#include "lecture2.h"
+#include "lecture3.h"
+#include "parallel.h"
+
+// Non-interactive driver: runs many independent jobs from one input, in parallel, and writes their results
+// in input order, one line per job.
+//
+// A job is a line naming it, followed by its data, one item per line, and ends at an empty line (or at the
+// end of the input):
+//   hull       points "(x,y)": their convex hull, counter-clockwise from graham_scan's pivot
+//   polygon    points: the same points in the order of simple_polygon_v3
+//   closest    points: "<distance> (x1,y1) (x2,y2)", or "none" for fewer than 2 points
+//   intersect  pairs of segments "(x1,y1) (x2,y2) (x3,y3) (x4,y4)": 1 or 0 for each pair
+// A job which can't be parsed gives a line "error: ..." and the others still run.
+//
+// The input is read in blocks of whole jobs. The jobs of a block are shared out between the threads in
+// groups, each group writing its results to its own buffer; the buffers are then written out in order.
+
+namespace {
+
+const char usage[] = R"(usage: batch [input] [-o output] [--threads n]
+  input            file of jobs, or '-' for the standard input (default)
+  -o output        file for the results, or '-' for the standard output (default)
+  --threads n      number of threads (default: all the cores)
+)";
+
+// Reads about that much input at a time, and gives each task that many jobs.
+constexpr std::size_t block_size = 8 << 20;
+constexpr std::size_t jobs_per_task = 64;
+
+using Text = std::string_view;
+
+/**
+ * Splits text into lines, without their end of line ("\n" or "\r\n").
+ */
+class Lines
+{
+public:
+    explicit Lines(Text text) : m_rest(text) {}
+
+    bool next(Text &line)
+    {
+        if (m_rest.empty()) return false;
+
+        std::size_t nl = m_rest.find('\n');
+        line = m_rest.substr(0, nl);
+        m_rest.remove_prefix(nl == Text::npos ? m_rest.size() : nl + 1);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        return true;
+    }
+
+private:
+    Text m_rest;
+};
+
+bool blank(Text line)
+{
+    return std::all_of(line.begin(), line.end(), [](char c) { return c == ' ' || c == '\t'; });
+}
+
+Text trim(Text line)
+{
+    while (!line.empty() && (line.front() == ' ' || line.front() == '\t')) line.remove_prefix(1);
+    while (!line.empty() && (line.back() == ' ' || line.back() == '\t')) line.remove_suffix(1);
+    return line;
+}
+
+/**
+ * Parses count points from line, which must hold nothing else. Returns false if it doesn't.
+ */
+bool parse_points(Text line, Point *out, std::size_t count)
+{
+    const char *it = line.data();
+    const char *last = line.data() + line.size();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (!(it = parse_point(it, last, out[i]))) return false;
+    }
+    return blank(Text(it, last - it));
+}
+
+void append(std::string &out, double v)
+{
+    char buf[32];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof buf, v);
+    out.append(buf, end);
+}
+
+void append(std::string &out, Point p)
+{
+    out += '(';
+    append(out, p.x);
+    out += ',';
+    append(out, p.y);
+    out += ')';
+}
+
+void append(std::string &out, const PointSet &ps)
+{
+    for (std::size_t i = 0; i < ps.size(); ++i)
+    {
+        if (i) out += ' ';
+        append(out, ps[i]);
+    }
+}
+
+/**
+ * Scratch of one task, reused from job to job.
+ */
+struct Scratch
+{
+    PointSet points;
+    PointSet hull;
+};
+
+/**
+ * Runs the job in text (its name line and its data lines) and appends its result line to out.
+ */
+void run_job(Text text, Scratch &scratch, std::string &out)
+{
+    Lines lines(text);
+    Text line;
+    lines.next(line);
+    Text name = trim(line);
+    std::size_t line_number = 1;
+
+    auto error = [&](const char *what) {
+        out += "error: ";
+        out += what;
+        out += " (line ";
+        out += std::to_string(line_number);
+        out += " of job '";
+        out.append(name.data(), name.size());
+        out += "')\n";
+    };
+
+    if (name == "intersect") {
+        std::size_t start = out.size();
+        while (lines.next(line))
+        {
+            ++line_number;
+            Point p[4];
+            if (!parse_points(line, p, 4)) {
+                out.resize(start);
+                return error("expected 2 segments");
+            }
+            if (out.size() > start) out += ' ';
+            out += intersect(Line{p[0], p[1]}, Line{p[2], p[3]}) ? '1' : '0';
+        }
+        out += '\n';
+        return;
+    }
+
+    if (name != "hull" && name != "polygon" && name != "closest") {
+        return error("unknown job");
+    }
+
+    PointSet &ps = scratch.points;
+    ps.clear();
+    while (lines.next(line))
+    {
+        ++line_number;
+        Point p;
+        if (!parse_points(line, &p, 1)) return error("expected a point");
+        ps.push_back(p);
+    }
+
+    if (name == "hull") {
+        // Monotone chain from graham_scan's pivot: the same hull, and it also takes fewer than 3 points,
+        // or copies of a point.
+        PointSet &hull = scratch.hull;
+        hull.resize(2 * ps.size());
+        hull.resize(problem3::monotone_chain(range(ps.begin(), ps.end()), hull.data()));
+        problem3::start_at_pivot(hull);
+        append(out, hull);
+    } else if (name == "polygon") {
+        if (!ps.empty()) problem2::simple_polygon_v3(ps);
+        append(out, ps);
+    } else if (ps.size() < 2) {
+        out += "none";
+    } else {
+        auto res = problem4::closest_pair(ps);
+        append(out, std::sqrt(res.squared_distance));
+        out += ' ';
+        append(out, res.closest_pair.first);
+        out += ' ';
+        append(out, res.closest_pair.second);
+    }
+    out += '\n';
+}
+
+/**
+ * Splits text into jobs: runs of non-empty lines.
+ */
+void split_jobs(Text text, std::vector<Text> &jobs)
+{
+    Lines lines(text);
+    Text line;
+    const char *start = nullptr;
+    const char *end = nullptr;
+    while (lines.next(line))
+    {
+        if (blank(line)) {
+            if (start) jobs.emplace_back(start, end - start);
+            start = nullptr;
+            continue;
+        }
+        if (!start) start = line.data();
+        end = line.data() + line.size();
+    }
+    if (start) jobs.emplace_back(start, end - start);
+}
+
+/**
+ * Length of the prefix of text made of whole jobs: up to its last empty line.
+ */
+std::size_t whole_jobs(Text text)
+{
+    for (std::size_t nl = text.rfind('\n'); nl != Text::npos && nl > 0; nl = text.rfind('\n', nl - 1))
+    {
+        std::size_t prev = text.rfind('\n', nl - 1);
+        Text line = text.substr(prev == Text::npos ? 0 : prev + 1, nl - (prev == Text::npos ? 0 : prev + 1));
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (blank(line)) return nl + 1;
+    }
+    return 0;
+}
+
+bool run_batch(std::FILE *in, std::FILE *out, unsigned threads)
+{
+    std::vector<char> buffer(block_size);
+    std::size_t filled = 0;
+    std::vector<Text> jobs;
+    std::vector<std::string> results;
+    std::vector<Scratch> scratch(threads * 4);
+    bool eof = false;
+
+    while (!eof)
+    {
+        if (filled == buffer.size()) buffer.resize(2 * buffer.size()); // A job bigger than a block.
+        filled += std::fread(buffer.data() + filled, 1, buffer.size() - filled, in);
+        eof = filled < buffer.size();
+        if (std::ferror(in)) return false;
+
+        Text text(buffer.data(), filled);
+        std::size_t len = eof ? filled : whole_jobs(text);
+        if (len == 0) continue;
+
+        jobs.clear();
+        split_jobs(text.substr(0, len), jobs);
+
+        std::size_t tasks = (jobs.size() + jobs_per_task - 1) / jobs_per_task;
+        if (results.size() < tasks) results.resize(tasks);
+        if (scratch.size() < tasks) scratch.resize(tasks);
+        parallel_for(tasks, [&](std::size_t t) {
+            std::string &res = results[t];
+            res.clear();
+            for (std::size_t j = t * jobs_per_task, end = std::min(jobs.size(), j + jobs_per_task); j < end; ++j)
+            {
+                run_job(jobs[j], scratch[t], res);
+            }
+        }, threads);
+
+        for (std::size_t t = 0; t < tasks; ++t)
+        {
+            if (std::fwrite(results[t].data(), 1, results[t].size(), out) != results[t].size()) return false;
+        }
+
+        // Keep the incomplete job at the end for the next block.
+        std::memmove(buffer.data(), buffer.data() + len, filled - len);
+        filled -= len;
+    }
+    return std::fflush(out) == 0;
+}
+
+} // end anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    const char *input = "-";
+    const char *output = "-";
+    unsigned threads = hardware_threads();
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = std::max(1, std::atoi(argv[++i]));
+        } else if (argv[i][0] != '-' || std::strcmp(argv[i], "-") == 0) {
+            input = argv[i];
+        } else {
+            std::cerr << usage;
+            return 1;
+        }
+    }
+
+    std::FILE *in = std::strcmp(input, "-") == 0 ? stdin : std::fopen(input, "rb");
+    std::FILE *out = std::strcmp(output, "-") == 0 ? stdout : std::fopen(output, "wb");
+    if (!in || !out) {
+        std::cerr << "cannot open \"" << (in ? output : input) << "\": " << std::strerror(errno) << ".\n";
+        return 1;
+    }
+
+    bool ok = run_batch(in, out, threads);
+    if (!ok) std::cerr << "error while reading or writing: " << std::strerror(errno) << ".\n";
+    if (in != stdin) std::fclose(in);
+    if (out != stdout) std::fclose(out);
+    return ok ? 0 : 1;
+}
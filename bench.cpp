@@ -0,0 +1,420 @@
+//
+// Created by bruno on 22/01/18.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "delaunay.h"
+#include "instrument.h"
+#include "kdtree.h"
+#include "lecture1.h"
+#include "lecture2.h"
+#include "lecture3.h"
+#include "point_location.h"
+#include "sweep_and_prune.h"
+
+// Benchmarks of the algorithms of the lectures on synthetic point sets, for tracking regressions.
+// - Datasets are generated from a fixed seed: a dataset of a given size is the same on every run.
+// - n goes over the powers of 10 from 10^min_exp to 10^max_exp.
+// - Each case is repeated (by default as many times as fit in about a second, at least 3 and at most 100).
+//   The input is restored before each repetition, outside of the timing.
+// - Once the median of a case is over the budget, the larger sizes are skipped for that dataset and algorithm.
+// - Results are printed on the standard error as they come, and written as CSV and/or JSON at the end.
+// - Built with instrumentation (see instrument.h), the JSON also has the phase timings and counters of each case,
+//   summed over its repetitions.
+
+namespace {
+
+const char usage[] = R"(usage: bench [options]
+  --min-exp <e>         smallest n is 10^e (default 2)
+  --max-exp <e>         largest n is 10^e (default 8)
+  --reps <r>            repetitions of each case (default: as many as fit in about a second)
+  --budget <seconds>    skip larger n once the median of a case is over this (default 10)
+  --dataset <name>      only this dataset (repeatable): square, disk, circle, clusters, duplicates
+  --algorithm <name>    only this algorithm (repeatable)
+  --csv <file>          write the results as CSV ('-' for the standard output)
+  --json <file>         write the results as JSON ('-' for the standard output)
+)";
+
+enum class Dataset
+{
+    square,     // Uniform in the unit square.
+    disk,       // Uniform in the unit disk.
+    circle,     // On the unit circle: every point is on the hull.
+    clusters,   // Gaussian clusters around a few random centres.
+    duplicates, // About 100 copies of each distinct point.
+};
+
+const std::pair<Dataset, const char *> datasets[] = {
+    {Dataset::square, "square"},
+    {Dataset::disk, "disk"},
+    {Dataset::circle, "circle"},
+    {Dataset::clusters, "clusters"},
+    {Dataset::duplicates, "duplicates"},
+};
+
+PointSet generate(Dataset dataset, std::size_t n)
+{
+    std::mt19937_64 rng{n * 8 + static_cast<std::size_t>(dataset)};
+    std::uniform_real_distribution<double> unit(0, 1);
+    PointSet ps(n);
+
+    switch (dataset) {
+    case Dataset::square:
+        for (Point &p : ps) p = {unit(rng), unit(rng)};
+        break;
+    case Dataset::disk:
+        for (Point &p : ps)
+        {
+            double r = std::sqrt(unit(rng));
+            double angle = 2 * pi * unit(rng);
+            p = {r * std::cos(angle), r * std::sin(angle)};
+        }
+        break;
+    case Dataset::circle:
+        for (Point &p : ps)
+        {
+            double angle = 2 * pi * unit(rng);
+            p = {std::cos(angle), std::sin(angle)};
+        }
+        break;
+    case Dataset::clusters: {
+        PointSet centres(16);
+        for (Point &c : centres) c = {unit(rng), unit(rng)};
+        std::normal_distribution<double> offset(0, 0.01);
+        for (Point &p : ps)
+        {
+            Point c = centres[rng() % centres.size()];
+            p = {c.x + offset(rng), c.y + offset(rng)};
+        }
+        break;
+    }
+    case Dataset::duplicates: {
+        PointSet distinct(std::max<std::size_t>(1, n / 100));
+        for (Point &p : distinct) p = {unit(rng), unit(rng)};
+        for (Point &p : ps) p = distinct[rng() % distinct.size()];
+        break;
+    }
+    }
+    return ps;
+}
+
+/**
+ * State of a benchmark: the input of the algorithm, and a sink for its results so that they are not optimised away.
+ */
+struct Workload
+{
+    PointSet points;
+    std::vector<Line> segments;
+    std::optional<PolygonIndex> polygon;
+    std::optional<KdTree> tree;
+    std::vector<PointSet> hulls;
+    std::optional<SweepAndPrune> broad_phase;
+    std::optional<problem4::DynamicClosestPair> tracked;
+    std::size_t frame = 0;
+    std::size_t sink = 0;
+};
+
+struct Algorithm
+{
+    const char *name;
+    void (*prepare)(const PointSet &input, Workload &w); // Before each repetition, not timed.
+    void (*run)(Workload &w);
+};
+
+void copy_points(const PointSet &input, Workload &w)
+{
+    w.points = input;
+}
+
+// Segments between consecutive points, each tested against the next one.
+void make_segments(const PointSet &input, Workload &w)
+{
+    w.segments.clear();
+    for (std::size_t i = 0; i + 1 < input.size(); i += 2) w.segments.push_back({input[i], input[i + 1]});
+}
+
+// Short segments from each point (about as long as the points are apart), for a broad phase.
+void make_broad_phase(const PointSet &input, Workload &w)
+{
+    double len = 1 / std::sqrt(double(std::max<std::size_t>(1, input.size())));
+    w.segments.clear();
+    for (Point p : input) w.segments.push_back({p, {p.x + len, p.y + len}});
+    w.broad_phase.emplace(w.segments);
+}
+
+// Hulls of chunks of 1000 points, to be merged.
+void make_hulls(const PointSet &input, Workload &w)
+{
+    w.hulls.clear();
+    for (std::size_t i = 0; i < input.size(); i += 1000)
+    {
+        w.hulls.push_back(problem3::monotone_chain(PointSet(input.begin() + i, input.begin() + std::min(input.size(), i + 1000))));
+        problem3::start_at_pivot(w.hulls.back());
+    }
+}
+
+// The first half of the points tracked, and the other half to replace them one by one.
+void make_tracking(const PointSet &input, Workload &w)
+{
+    w.tracked.emplace(PointSet(input.begin(), input.begin() + input.size() / 2));
+    w.points.assign(input.begin() + input.size() / 2, input.end());
+}
+
+// The simple polygon of the first half of the points (without copies), indexed, and the other half as
+// queries against it.
+void make_polygon(const PointSet &input, Workload &w)
+{
+    PointSet polygon(input.begin(), input.begin() + input.size() / 2);
+    std::sort(polygon.begin(), polygon.end(), [](Point a, Point b) { return a.x < b.x || (a.x == b.x && a.y < b.y); });
+    polygon.erase(std::unique(polygon.begin(), polygon.end(), [](Point a, Point b) { return a.x == b.x && a.y == b.y; }),
+                  polygon.end());
+    problem2::simple_polygon_v4(polygon);
+    w.polygon.emplace(polygon);
+    w.points.assign(input.begin() + input.size() / 2, input.end());
+}
+
+// The k-d tree of the first half of the points, and the other half as queries against it.
+void make_kdtree(const PointSet &input, Workload &w)
+{
+    w.tree.emplace(PointSet(input.begin(), input.begin() + input.size() / 2));
+    w.points.assign(input.begin() + input.size() / 2, input.end());
+}
+
+const Algorithm algorithms[] = {
+    {"simple_polygon_v1", copy_points, [](Workload &w) { problem2::simple_polygon_v1(w.points); }},
+    {"simple_polygon_v2", copy_points, [](Workload &w) { problem2::simple_polygon_v2(w.points); }},
+    {"simple_polygon_v3", copy_points, [](Workload &w) { problem2::simple_polygon_v3(w.points); }},
+    {"simple_polygon_v4", copy_points, [](Workload &w) { problem2::simple_polygon_v4(w.points); }},
+    {"graham_scan", copy_points, [](Workload &w) { w.sink += problem3::graham_scan(w.points, false).size(); }},
+    {"closest_pair", copy_points, [](Workload &w) { w.sink += problem4::closest_pair(w.points).squared_distance > 0; }},
+    {"closest_pair_parallel", copy_points,
+     [](Workload &w) { w.sink += problem4::closest_pair_parallel(w.points).squared_distance > 0; }},
+    {"delaunay", copy_points, [](Workload &w) { w.sink += Delaunay(w.points).triangles().size(); }},
+    {"nearest_neighbors", copy_points, [](Workload &w) { w.sink += Delaunay(w.points).nearest_neighbors().size(); }},
+    {"dynamic_closest_pair", make_tracking, [](Workload &w) {
+        // The replaced point takes the id of the removed one.
+        for (std::size_t i = 0; i < w.points.size() && w.tracked->size() > 0; ++i)
+        {
+            w.tracked->erase(i % w.tracked->size());
+            w.tracked->insert(w.points[i]);
+            w.sink += w.tracked->closest_pair().squared_distance > 0;
+        }
+    }},
+    {"merge_hulls", make_hulls, [](Workload &w) { w.sink += problem3::merge_hulls(std::move(w.hulls)).size(); }},
+    {"point_location", make_polygon, [](Workload &w) {
+        for (Location l : w.polygon->locate(w.points)) w.sink += l == Location::inside;
+    }},
+    {"kdtree_nearest", make_kdtree, [](Workload &w) {
+        for (const KdTree::Neighbor &nb : w.tree->nearest(w.points, 4)) w.sink += nb.index;
+    }},
+    {"kdtree_within", make_kdtree, [](Workload &w) {
+        // About 4 points within the radius of each query, for points spread over the unit square.
+        double r = std::sqrt(4 / (pi * std::max<std::size_t>(1, w.tree->size())));
+        w.sink += w.tree->within(w.points, r).indices.size();
+    }},
+    {"sweep_and_prune", make_broad_phase, [](Workload &w) {
+        // One frame: every segment moves a little, left and right in turn.
+        double dx = w.frame++ % 2 ? 1e-6 : -1e-6;
+        for (std::size_t i = 0; i < w.segments.size(); ++i)
+        {
+            Line l = w.broad_phase->segment(i);
+            w.broad_phase->move(i, {{l.p1.x + dx, l.p1.y}, {l.p2.x + dx, l.p2.y}});
+        }
+        w.broad_phase->for_each_intersection([&](std::size_t, std::size_t) { ++w.sink; });
+    }},
+    {"intersect", make_segments, [](Workload &w) {
+        for (std::size_t i = 1; i < w.segments.size(); ++i) w.sink += intersect(w.segments[i - 1], w.segments[i]);
+    }},
+};
+
+struct Result
+{
+    const char *dataset;
+    const char *algorithm;
+    std::size_t n;
+    std::size_t reps;
+    double median_ns;
+    double p99_ns;
+    double min_ns;
+    instrument::Stats stats;
+
+    double points_per_s() const { return n / (median_ns * 1e-9); }
+};
+
+struct Options
+{
+    int min_exp = 2;
+    int max_exp = 8;
+    std::size_t reps = 0; // 0: automatic.
+    double budget_s = 10;
+    std::vector<std::string> datasets;
+    std::vector<std::string> algorithms;
+    std::string csv;
+    std::string json;
+};
+
+bool selected(const std::vector<std::string> &names, const char *name)
+{
+    return names.empty() || std::find(names.begin(), names.end(), name) != names.end();
+}
+
+Result measure(const Algorithm &algorithm, const PointSet &input, const Options &opts, Workload &w)
+{
+    using namespace std::chrono;
+    std::vector<double> samples;
+    nanoseconds total{0};
+    instrument::reset();
+    while (opts.reps ? samples.size() < opts.reps
+                     : samples.size() < 3 || (total < seconds(1) && samples.size() < 100))
+    {
+        algorithm.prepare(input, w);
+        nanoseconds t = time_ns([&] { algorithm.run(w); });
+        samples.push_back(static_cast<double>(t.count()));
+        total += t;
+        // A single repetition over the budget is enough to know the case is too big.
+        if (!opts.reps && t > duration<double>(opts.budget_s)) break;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    std::size_t k = samples.size();
+    Result res{};
+    res.stats = instrument::snapshot();
+    res.reps = k;
+    res.median_ns = k % 2 ? samples[k / 2] : (samples[k / 2 - 1] + samples[k / 2]) / 2;
+    res.p99_ns = samples[(99 * k + 99) / 100 - 1]; // Nearest rank.
+    res.min_ns = samples.front();
+    return res;
+}
+
+void write_csv(std::ostream &out, const std::vector<Result> &results)
+{
+    out << "dataset,algorithm,n,reps,median_ns,p99_ns,min_ns,points_per_s\n";
+    for (const Result &r : results)
+    {
+        out << r.dataset << ',' << r.algorithm << ',' << r.n << ',' << r.reps << ','
+            << r.median_ns << ',' << r.p99_ns << ',' << r.min_ns << ',' << r.points_per_s() << '\n';
+    }
+}
+
+void write_json(std::ostream &out, const std::vector<Result> &results)
+{
+    out << "[\n";
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const Result &r = results[i];
+        out << "  {\"dataset\": \"" << r.dataset << "\", \"algorithm\": \"" << r.algorithm << "\", \"n\": " << r.n
+            << ", \"reps\": " << r.reps << ", \"median_ns\": " << r.median_ns << ", \"p99_ns\": " << r.p99_ns
+            << ", \"min_ns\": " << r.min_ns << ", \"points_per_s\": " << r.points_per_s();
+        if (instrument::enabled) {
+            out << ", \"stats\": ";
+            instrument::dump(out, r.stats);
+        }
+        out << "}" << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "]\n";
+}
+
+bool write(const std::string &path, const std::vector<Result> &results,
+           void (*writer)(std::ostream &, const std::vector<Result> &))
+{
+    std::ofstream file;
+    if (path != "-") file.open(path);
+    std::ostream &out = path == "-" ? std::cout : file;
+    out << std::setprecision(12);
+    writer(out, results);
+    if (!out.flush()) {
+        std::cerr << "cannot write \"" << path << "\".\n";
+        return false;
+    }
+    return true;
+}
+
+bool parse_options(int argc, char *argv[], Options &opts)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        if (i + 1 >= argc) return false;
+        const char *value = argv[++i];
+
+        if (std::strcmp(arg, "--min-exp") == 0) {
+            opts.min_exp = std::atoi(value);
+        } else if (std::strcmp(arg, "--max-exp") == 0) {
+            opts.max_exp = std::atoi(value);
+        } else if (std::strcmp(arg, "--reps") == 0) {
+            opts.reps = std::strtoul(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--budget") == 0) {
+            opts.budget_s = std::atof(value);
+        } else if (std::strcmp(arg, "--dataset") == 0) {
+            opts.datasets.push_back(value);
+        } else if (std::strcmp(arg, "--algorithm") == 0) {
+            opts.algorithms.push_back(value);
+        } else if (std::strcmp(arg, "--csv") == 0) {
+            opts.csv = value;
+        } else if (std::strcmp(arg, "--json") == 0) {
+            opts.json = value;
+        } else {
+            return false;
+        }
+    }
+    return opts.min_exp >= 0 && opts.min_exp <= opts.max_exp && opts.max_exp <= 9;
+}
+
+} // end anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    Options opts;
+    if (!parse_options(argc, argv, opts)) {
+        std::cerr << usage;
+        return 1;
+    }
+
+    std::vector<Result> results;
+    Workload w;
+    for (auto [dataset, dataset_name] : datasets)
+    {
+        if (!selected(opts.datasets, dataset_name)) continue;
+
+        std::vector<bool> over_budget(std::size(algorithms), false);
+        std::size_t n = 1;
+        for (int e = 0; e < opts.min_exp; ++e) n *= 10;
+        for (int e = opts.min_exp; e <= opts.max_exp; ++e, n *= 10)
+        {
+            PointSet input = generate(dataset, n);
+            for (std::size_t a = 0; a < std::size(algorithms); ++a)
+            {
+                const Algorithm &algorithm = algorithms[a];
+                if (!selected(opts.algorithms, algorithm.name) || over_budget[a]) continue;
+
+                Result res = measure(algorithm, input, opts, w);
+                res.dataset = dataset_name;
+                res.algorithm = algorithm.name;
+                res.n = n;
+                results.push_back(res);
+                over_budget[a] = res.median_ns * 1e-9 > opts.budget_s;
+
+                std::cerr << std::left << std::setw(11) << dataset_name << std::setw(22) << algorithm.name
+                          << std::right << std::setw(10) << n << std::setw(5) << res.reps << " reps  median "
+                          << std::setw(12) << res.median_ns / 1e3 << " us  p99 " << std::setw(12) << res.p99_ns / 1e3
+                          << " us  " << std::setw(12) << res.points_per_s() << " points/s" << std::endl;
+            }
+        }
+    }
+    bool ok = true;
+    if (!opts.csv.empty()) ok &= write(opts.csv, results, write_csv);
+    if (!opts.json.empty()) ok &= write(opts.json, results, write_json);
+    return ok ? 0 : 1;
+}
@@ -10,42 +10,183 @@
 #include <iostream>
 #include <algorithm>
 #include <chrono>
+#include <cstdlib>
+#include <charconv>
+#include <iterator>
 
-struct Vec2d
+// The geometry types are templates over the type of the coordinates (see predicates::Kernel for the ones
+// supported). double is the default: Point, Vec2d, Line and PointSet.
+
+template <class T>
+struct BasicVec2d
 {
-    double x;
-    double y;
+    T x;
+    T y;
 };
 
-struct Point
+template <class T>
+struct BasicPoint
 {
-    double x;
-    double y;
+    using coordinate_type = T;
 
-    // Extra data.
-    union {
-        double _ordering = 0; // Used for sorting by external values.
-    };
+    T x;
+    T y;
+
+    // Values used for sorting (eg. angles) are kept in arrays of their own, not in the points.
 
-    friend Vec2d operator -(Point lhs, Point rhs)
+    friend BasicVec2d<T> operator -(BasicPoint lhs, BasicPoint rhs)
     {
         return {lhs.x - rhs.x, lhs.y - rhs.y};
     }
 };
 
-struct Line
+template <class T>
+struct BasicLine
 {
-    Point p1;
-    Point p2;
+    BasicPoint<T> p1;
+    BasicPoint<T> p2;
 };
 
+using Vec2d = BasicVec2d<double>;
+using Point = BasicPoint<double>;
+using Line = BasicLine<double>;
 using PointSet = std::vector<Point>;
 
+static_assert(sizeof(Point) == 2 * sizeof(double), "Point should stay as compact as possible");
+
+/**
+ * Points stored as separate arrays of coordinates, so that a pass over one coordinate
+ * (eg. a filter on x) only touches that coordinate.
+ */
+struct PointColumns
+{
+    std::vector<double> x;
+    std::vector<double> y;
+
+    PointColumns() = default;
+
+    explicit PointColumns(const PointSet &ps)
+    {
+        x.reserve(ps.size());
+        y.reserve(ps.size());
+        for (Point p : ps) push_back(p);
+    }
+
+    void push_back(Point p)
+    {
+        x.push_back(p.x);
+        y.push_back(p.y);
+    }
+
+    std::size_t size() const { return x.size(); }
+
+    Point operator [](std::size_t i) const { return {x[i], y[i]}; }
+};
+
+/**
+ * Read-only view over points stored as separate arrays of x and y coordinates
+ * (eg. a memory-mapped point file). Points are produced by value.
+ */
+class PointView
+{
+public:
+    class iterator
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type        = Point;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = Point;
+
+        iterator(const PointView *view, std::size_t i) : m_view(view), m_i(i) {}
+
+        Point operator *() const { return (*m_view)[m_i]; }
+        Point operator [](difference_type n) const { return (*m_view)[m_i + n]; }
+
+        iterator &operator ++() { ++m_i; return *this; }
+        iterator &operator --() { --m_i; return *this; }
+        iterator operator ++(int) { return {m_view, m_i++}; }
+        iterator operator --(int) { return {m_view, m_i--}; }
+        iterator &operator +=(difference_type n) { m_i += n; return *this; }
+        iterator &operator -=(difference_type n) { m_i -= n; return *this; }
+        iterator operator +(difference_type n) const { return {m_view, m_i + n}; }
+        iterator operator -(difference_type n) const { return {m_view, m_i - n}; }
+        difference_type operator -(iterator rhs) const { return difference_type(m_i) - difference_type(rhs.m_i); }
+
+        bool operator ==(iterator rhs) const { return m_i == rhs.m_i; }
+        bool operator !=(iterator rhs) const { return m_i != rhs.m_i; }
+        bool operator <(iterator rhs) const  { return m_i < rhs.m_i; }
+
+    private:
+        const PointView *m_view;
+        std::size_t m_i;
+    };
+
+    PointView(const double *x, const double *y, std::size_t size, bool sorted_by_x = false)
+        : m_x(x), m_y(y), m_size(size), m_sorted_by_x(sorted_by_x) {}
+
+    PointView(const PointColumns &pc, bool sorted_by_x = false)
+        : PointView(pc.x.data(), pc.y.data(), pc.size(), sorted_by_x) {}
+
+    Point operator [](std::size_t i) const { return {m_x[i], m_y[i]}; }
+
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    const double *xs() const { return m_x; }
+    const double *ys() const { return m_y; }
+
+    /**
+     * Whether the points are known to be sorted on their x-coord.
+     */
+    bool sorted_by_x() const { return m_sorted_by_x; }
+
+    iterator begin() const { return {this, 0}; }
+    iterator end() const   { return {this, m_size}; }
+
+private:
+    const double *m_x;
+    const double *m_y;
+    std::size_t m_size;
+    bool m_sorted_by_x;
+};
+
 inline void white_strip(std::string & res)
 {
     res.erase(std::remove_if(res.begin(), res.end(), isspace), res.end());
 };
 
+/**
+ * Parses a point written as "(x,y)" (blanks allowed around each token) at the start of [first, last).
+ * Returns the position after the closing parenthesis, or nullptr if there is no point there.
+ */
+inline const char *parse_point(const char *first, const char *last, Point &p)
+{
+    auto skip_blanks = [last](const char *it) {
+        while (it != last && (*it == ' ' || *it == '\t' || *it == '\r')) ++it;
+        return it;
+    };
+    auto expect = [&](const char *it, char c) -> const char * {
+        it = skip_blanks(it);
+        return (it != last && *it == c) ? it + 1 : nullptr;
+    };
+    auto number = [&](const char *it, double &value) -> const char * {
+        it = skip_blanks(it);
+        if (it != last && *it == '+') ++it;
+        auto [ptr, ec] = std::from_chars(it, last, value);
+        return ec == std::errc{} ? ptr : nullptr;
+    };
+
+    const char *it = first;
+    if (!(it = expect(it, '(')) || !(it = number(it, p.x)) ||
+        !(it = expect(it, ',')) || !(it = number(it, p.y)) ||
+        !(it = expect(it, ')'))) {
+        return nullptr;
+    }
+    return it;
+}
+
 inline PointSet ask_pointset()
 {
     PointSet ps;
@@ -55,16 +196,52 @@ inline PointSet ask_pointset()
 
     while (std::getline(std::cin, str))
     {
-        white_strip(str);
-        double x,y;
-        if (sscanf(str.c_str(), "(%lf,%lf)", &x, &y) != 2) {
+        Point p;
+        if (!parse_point(str.data(), str.data() + str.size(), p)) {
             break;
         }
-        ps.push_back({x, y});
+        ps.push_back(p);
     }
     return ps;
 }
 
+inline Line ask_line()
+{
+    std::cout << "Type points for line segment ( eg (1,2) (3,4) ): ";
+
+    double p1x, p1y, p2x, p2y;
+    std::string res;
+
+    std::getline(std::cin, res);
+    white_strip(res);
+    if (sscanf(res.c_str(), "(%lf,%lf)(%lf,%lf)", &p1x, &p1y, &p2x, &p2y) != 4)
+    {
+        std::cerr << "error in parsing \"" << res << "\".\n";
+        std::abort();
+    }
+
+    return {{p1x, p1y}, {p2x, p2y}};
+}
+
+inline std::vector<Line> ask_lineset()
+{
+    std::vector<Line> ls;
+    std::string str;
+
+    std::cout << "Type a series of lines of line segments (eg (1,2) (3,4) ).\n";
+
+    while (std::getline(std::cin, str))
+    {
+        white_strip(str);
+        double p1x, p1y, p2x, p2y;
+        if (sscanf(str.c_str(), "(%lf,%lf)(%lf,%lf)", &p1x, &p1y, &p2x, &p2y) != 4) {
+            break;
+        }
+        ls.push_back({{p1x, p1y}, {p2x, p2y}});
+    }
+    return ls;
+}
+
 /*
 struct PointSet
 {
@@ -73,14 +250,22 @@ struct PointSet
 */
 
 
-inline std::ostream &operator <<(std::ostream &out, Point p)
+template <class T>
+std::ostream &operator <<(std::ostream &out, BasicPoint<T> p)
 {
     return out << "(" << p.x << "," << p.y << ")";
 }
 
-inline std::ostream &operator <<(std::ostream &out, const PointSet &ps)
+template <class T>
+std::ostream &operator <<(std::ostream &out, BasicLine<T> l)
+{
+    return out << l.p1 << "-" << l.p2;
+}
+
+template <class T>
+std::ostream &operator <<(std::ostream &out, const std::vector<BasicPoint<T>> &ps)
 {
-    for (Point p : ps)
+    for (BasicPoint<T> p : ps)
     {
         out << p << " ";
     }
@@ -113,6 +298,17 @@ public:
     It m_end;
 };
 
+template <class It>
+std::ostream &operator <<(std::ostream &out, range<It> rng)
+{
+    for (auto p : rng)
+    {
+        out << p << " ";
+    }
+
+    return out;
+}
+
 template <class Fn, class... Args>
 std::chrono::microseconds time_us(Fn &&fn, Args &&... args)
 {
@@ -122,4 +318,16 @@ std::chrono::microseconds time_us(Fn &&fn, Args &&... args)
     return std::chrono::duration_cast<std::chrono::microseconds>(end - start);
 }
 
+/**
+ * Same as time_us, for runs too short to be measured in microseconds.
+ */
+template <class Fn, class... Args>
+std::chrono::nanoseconds time_ns(Fn &&fn, Args &&... args)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn(std::forward<Args>(args)...);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+}
+
 #endif //UNTITLED_COMMON_H
@@ -0,0 +1,459 @@
+//
+// Created by bruno on 25/01/18.
+//
+
+#ifndef UNTITLED_DELAUNAY_H
+#define UNTITLED_DELAUNAY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+#include "instrument.h"
+#include "lecture3.h"
+#include "predicates.h"
+
+// Delaunay triangulation: no point is inside the circumcircle of a triangle. Every point's nearest
+// neighbour, and so the closest pair, is joined to it by an edge; so are the edges of the Euclidean
+// minimum spanning tree. O(n) edges, so these are linear passes once the triangulation is built.
+//
+// Divide and conquer (Guibas and Stolfi), O(n log n) whatever the points:
+// - The points are sorted on x-coord (then y), as closest_pair sorts them, split in two halves, and each
+//   half triangulated on its own. The two are merged from the bottom up: the lower common tangent of their
+//   hulls is the first edge across, and each next one joins an end of the last one to the candidate, on
+//   either side, whose circle through that edge is empty. The edges of a side that the circle of its
+//   candidate shows aren't Delaunay are deleted on the way. O(n) per merge.
+// - While building, the edges are quad-edges: each one knows the next edge counter-clockwise around either
+//   of its ends, and around either of its faces. They are in flat arrays, and deleted ones are reused.
+// - All collinear points (and copies of a point, which are left out) are a special case.
+// Once built, no nodes: triangle t is half-edges 3t, 3t+1, 3t+2, counter-clockwise. Half-edge e goes from
+// point triangles[e] to the start of the next half-edge of its triangle; halfedges[e] is the same edge
+// in the other direction, in the neighbouring triangle, or none on the hull.
+
+class Delaunay
+{
+public:
+    static constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+    struct Edge
+    {
+        std::size_t a;
+        std::size_t b;
+        double squared_distance;
+    };
+
+    /**
+     * Triangulates ps. The sort on x-coord is skipped if ps is known to be sorted on it already (point files
+     * can be saved so).
+     */
+    template <class Points>
+    explicit Delaunay(const Points &ps, bool sorted_by_x = false)
+        : m_points(ps.begin(), ps.end()), m_same_as(ps.size(), none)
+    {
+        std::vector<std::size_t> order(ps.size());
+        std::iota(order.begin(), order.end(), 0);
+        auto xy_less = [this](std::size_t i, std::size_t j) {
+            Point p = m_points[i], q = m_points[j];
+            return p.x < q.x || (p.x == q.x && p.y < q.y);
+        };
+        {
+            INSTRUMENT_PHASE(sort);
+            if (!sorted_by_x) {
+                std::sort(order.begin(), order.end(), xy_less);
+            } else {
+                // Only the points with the same x-coord are left to put in order of y.
+                for (std::size_t first = 0, end; first < order.size(); first = end)
+                {
+                    for (end = first + 1; end < order.size() && m_points[end].x == m_points[first].x; ++end) {}
+                    std::sort(order.begin() + first, order.begin() + end, xy_less);
+                }
+            }
+        }
+
+        // Triangulated in that order, for locality, then numbered back as in ps.
+        PointSet input = std::move(m_points);
+        m_points.resize(input.size());
+        for (std::size_t i = 0; i < order.size(); ++i) m_points[i] = input[order[i]];
+        triangulate();
+        renumber(order);
+        m_points = std::move(input);
+    }
+
+    Delaunay(const PointView &pv) : Delaunay(pv, pv.sorted_by_x()) {}
+
+    const PointSet &points() const { return m_points; }
+
+    /**
+     * Point indices of the triangles, counter-clockwise, 3 per triangle.
+     */
+    const std::vector<std::size_t> &triangles() const { return m_triangles; }
+
+    /**
+     * Opposite half-edge of each half-edge, or none.
+     */
+    const std::vector<std::size_t> &halfedges() const { return m_halfedges; }
+
+    /**
+     * Points of the convex hull, counter-clockwise.
+     */
+    const std::vector<std::size_t> &hull() const { return m_hull; }
+
+    /**
+     * Calls fn(a, b) once for each edge, between points a and b. Copies of a point are joined to it.
+     */
+    template <class Fn>
+    void for_each_edge(Fn &&fn) const
+    {
+        for (std::size_t e = 0; e < m_triangles.size(); ++e)
+        {
+            if (m_halfedges[e] == none || m_halfedges[e] < e) fn(m_triangles[e], m_triangles[next(e)]);
+        }
+        for (std::size_t i = 0; i < m_chain.size(); ++i)
+        {
+            if (i > 0) fn(m_chain[i - 1], m_chain[i]);
+        }
+        for (std::size_t i = 0; i < m_same_as.size(); ++i)
+        {
+            if (m_same_as[i] != none) fn(m_same_as[i], i);
+        }
+    }
+
+    /**
+     * Index of the nearest other point of each point (a copy of it, if any), or none if there is only one point.
+     */
+    std::vector<std::size_t> nearest_neighbors() const
+    {
+        std::vector<std::size_t> nearest(m_points.size(), none);
+        std::vector<double> best(m_points.size(), std::numeric_limits<double>::infinity());
+        for_each_edge([&](std::size_t a, std::size_t b) {
+            double d = predicates::squared_distance(m_points[a], m_points[b]);
+            if (d < best[a]) best[a] = d, nearest[a] = b;
+            if (d < best[b]) best[b] = d, nearest[b] = a;
+        });
+        return nearest;
+    }
+
+    /**
+     * Same as problem4::closest_pair of the points.
+     */
+    problem4::ClosestPairResult closest_pair() const
+    {
+        problem4::ClosestPairResult closest = m_points.empty() ? problem4::ClosestPairResult{}
+                                                               : problem4::ClosestPairResult{m_points[0]};
+        for_each_edge([&](std::size_t a, std::size_t b) {
+            problem4::ClosestPairResult tentative{m_points[a], m_points[b]};
+            if (tentative < closest) closest = tentative;
+        });
+        return closest;
+    }
+
+    /**
+     * Edges of a Euclidean minimum spanning tree, by Kruskal's algorithm on the edges of the triangulation:
+     * O(n log n).
+     */
+    std::vector<Edge> euclidean_mst() const
+    {
+        std::vector<Edge> edges;
+        for_each_edge([&](std::size_t a, std::size_t b) {
+            edges.push_back({a, b, predicates::squared_distance(m_points[a], m_points[b])});
+        });
+        std::sort(edges.begin(), edges.end(), [](const Edge &e1, const Edge &e2) {
+            return e1.squared_distance < e2.squared_distance;
+        });
+
+        // Union-find, with path halving.
+        std::vector<std::size_t> parent(m_points.size());
+        std::iota(parent.begin(), parent.end(), 0);
+        auto find = [&](std::size_t i) {
+            while (parent[i] != i) i = parent[i] = parent[parent[i]];
+            return i;
+        };
+
+        std::vector<Edge> tree;
+        for (const Edge &e : edges)
+        {
+            std::size_t ra = find(e.a), rb = find(e.b);
+            if (ra != rb) {
+                parent[ra] = rb;
+                tree.push_back(e);
+            }
+        }
+        return tree;
+    }
+
+private:
+    static std::size_t next(std::size_t e) { return e % 3 == 2 ? e - 2 : e + 1; }
+
+    double orient(std::size_t a, std::size_t b, std::size_t c) const
+    {
+        return predicates::orient2d(m_points[a], m_points[b], m_points[c]);
+    }
+
+    /**
+     * Edges of a triangulation while it is built, as quad-edges in flat arrays. Edge e is in quad e / 4,
+     * with e % 4 = 0 and 2 the edge in either direction, 1 and 3 its dual (crossing it from right to left,
+     * and back).
+     */
+    class QuadEdges
+    {
+    public:
+        static std::size_t rot(std::size_t e) { return (e & ~std::size_t(3)) | ((e + 1) & 3); }
+        static std::size_t sym(std::size_t e) { return e ^ 2; }
+        static std::size_t rot_inverse(std::size_t e) { return (e & ~std::size_t(3)) | ((e + 3) & 3); }
+
+        std::size_t org(std::size_t e) const { return m_org[e]; }
+        std::size_t dest(std::size_t e) const { return m_org[sym(e)]; }
+        std::size_t onext(std::size_t e) const { return m_onext[e]; }
+        std::size_t oprev(std::size_t e) const { return rot(m_onext[rot(e)]); }
+        std::size_t lnext(std::size_t e) const { return rot(m_onext[rot_inverse(e)]); }
+        std::size_t rprev(std::size_t e) const { return m_onext[sym(e)]; }
+
+        std::size_t size() const { return m_onext.size(); }
+
+        void reserve(std::size_t quads)
+        {
+            m_onext.reserve(4 * quads);
+            m_org.reserve(4 * quads);
+        }
+        bool deleted(std::size_t e) const { return m_org[e & ~std::size_t(3)] == none; }
+
+        /**
+         * New edge from a to b, alone.
+         */
+        std::size_t make_edge(std::size_t a, std::size_t b)
+        {
+            std::size_t e = m_onext.size();
+            if (!m_free.empty()) {
+                e = m_free.back();
+                m_free.pop_back();
+            } else {
+                m_onext.resize(e + 4);
+                m_org.resize(e + 4);
+            }
+            m_onext[e] = e;
+            m_onext[e + 2] = e + 2;
+            m_onext[e + 1] = e + 3;
+            m_onext[e + 3] = e + 1;
+            m_org[e] = a;
+            m_org[e + 2] = b;
+            return e;
+        }
+
+        /**
+         * Joins the rings of edges around the origins of a and b if they are apart, splits them otherwise.
+         */
+        void splice(std::size_t a, std::size_t b)
+        {
+            std::size_t alpha = rot(m_onext[a]), beta = rot(m_onext[b]);
+            std::swap(m_onext[a], m_onext[b]);
+            std::swap(m_onext[alpha], m_onext[beta]);
+        }
+
+        /**
+         * New edge from the destination of a to the origin of b, with the face left of a and b on its left.
+         */
+        std::size_t connect(std::size_t a, std::size_t b)
+        {
+            std::size_t e = make_edge(dest(a), org(b));
+            splice(e, lnext(a));
+            splice(sym(e), b);
+            return e;
+        }
+
+        void delete_edge(std::size_t e)
+        {
+            splice(e, oprev(e));
+            splice(sym(e), oprev(sym(e)));
+            e &= ~std::size_t(3);
+            m_org[e] = m_org[e + 2] = none;
+            m_free.push_back(e);
+        }
+
+    private:
+        std::vector<std::size_t> m_onext;
+        std::vector<std::size_t> m_org; // Of the edges in either direction.
+        std::vector<std::size_t> m_free;
+    };
+
+    /**
+     * Triangulates m_points, sorted on x-coord then y-coord.
+     */
+    void triangulate()
+    {
+        std::size_t n = m_points.size();
+
+        // Copies of a point are left out, as copies of the first one.
+        std::vector<std::size_t> distinct;
+        distinct.reserve(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if (!distinct.empty() && m_points[i].x == m_points[distinct.back()].x &&
+                m_points[i].y == m_points[distinct.back()].y) {
+                m_same_as[i] = distinct.back();
+            } else {
+                distinct.push_back(i);
+            }
+        }
+
+        std::size_t k = 2;
+        while (k < distinct.size() && orient(distinct[0], distinct[1], distinct[k]) == 0) ++k;
+        if (k >= distinct.size()) {
+            // All on one line: no triangles, the points in order along it.
+            m_chain = distinct;
+            m_hull = distinct;
+            return;
+        }
+
+        QuadEdges edges;
+        edges.reserve(3 * distinct.size());
+        std::size_t right = divide_and_conquer(edges, distinct.data(), distinct.size()).second;
+        collect_triangles(edges);
+
+        // The hull is the face left of the clockwise hull edge out of the rightmost point.
+        std::vector<std::size_t> clockwise;
+        std::size_t e = right;
+        do {
+            clockwise.push_back(edges.org(e));
+            e = edges.lnext(e);
+        } while (e != right);
+        m_hull.assign(1, clockwise[0]);
+        m_hull.insert(m_hull.end(), clockwise.rbegin(), clockwise.rend() - 1);
+    }
+
+    /**
+     * Triangulates the n points of ps. Returns the counter-clockwise hull edge out of the first point, and
+     * the clockwise one out of the last point.
+     */
+    std::pair<std::size_t, std::size_t> divide_and_conquer(QuadEdges &edges, const std::size_t *ps, std::size_t n)
+    {
+        using Q = QuadEdges;
+        if (n == 2) {
+            std::size_t a = edges.make_edge(ps[0], ps[1]);
+            return {a, Q::sym(a)};
+        }
+        if (n == 3) {
+            std::size_t a = edges.make_edge(ps[0], ps[1]);
+            std::size_t b = edges.make_edge(ps[1], ps[2]);
+            edges.splice(Q::sym(a), b);
+            double o = orient(ps[0], ps[1], ps[2]);
+            if (o == 0) return {a, Q::sym(b)};
+            std::size_t c = edges.connect(b, a);
+            return o > 0 ? std::pair{a, Q::sym(b)} : std::pair{Q::sym(c), c};
+        }
+
+        auto [ldo, ldi] = divide_and_conquer(edges, ps, n / 2);
+        auto [rdi, rdo] = divide_and_conquer(edges, ps + n / 2, n - n / 2);
+
+        INSTRUMENT_PHASE(merge);
+        auto left_of = [&](std::size_t p, std::size_t e) { return orient(p, edges.org(e), edges.dest(e)) > 0; };
+        auto right_of = [&](std::size_t p, std::size_t e) { return orient(p, edges.dest(e), edges.org(e)) > 0; };
+
+        // Lower common tangent of the two hulls.
+        while (true)
+        {
+            if (left_of(edges.org(rdi), ldi)) {
+                ldi = edges.lnext(ldi);
+            } else if (right_of(edges.org(ldi), rdi)) {
+                rdi = edges.rprev(rdi);
+            } else {
+                break;
+            }
+        }
+
+        std::size_t base = edges.connect(Q::sym(rdi), ldi); // From right to left.
+        if (edges.org(ldi) == edges.org(ldo)) ldo = Q::sym(base);
+        if (edges.org(rdi) == edges.org(rdo)) rdo = base;
+
+        auto valid = [&](std::size_t e) { return right_of(edges.dest(e), base); };
+        auto in_circle = [&](std::size_t a, std::size_t b, std::size_t c, std::size_t d) {
+            return predicates::incircle(m_points[a], m_points[b], m_points[c], m_points[d]) > 0;
+        };
+        while (true)
+        {
+            // Candidates around the left and right ends of base, first deleting the edges they show aren't Delaunay.
+            std::size_t lcand = edges.onext(Q::sym(base));
+            if (valid(lcand)) {
+                while (in_circle(edges.dest(base), edges.org(base), edges.dest(lcand), edges.dest(edges.onext(lcand))))
+                {
+                    std::size_t t = edges.onext(lcand);
+                    edges.delete_edge(lcand);
+                    lcand = t;
+                }
+            }
+            std::size_t rcand = edges.oprev(base);
+            if (valid(rcand)) {
+                while (in_circle(edges.dest(base), edges.org(base), edges.dest(rcand), edges.dest(edges.oprev(rcand))))
+                {
+                    std::size_t t = edges.oprev(rcand);
+                    edges.delete_edge(rcand);
+                    rcand = t;
+                }
+            }
+
+            // Up to the upper common tangent.
+            if (!valid(lcand) && !valid(rcand)) break;
+            if (!valid(lcand) ||
+                (valid(rcand) && in_circle(edges.dest(lcand), edges.org(lcand), edges.org(rcand), edges.dest(rcand)))) {
+                base = edges.connect(rcand, Q::sym(base));
+            } else {
+                base = edges.connect(Q::sym(base), Q::sym(lcand));
+            }
+        }
+        return {ldo, rdo};
+    }
+
+    /**
+     * Triangles of the faces of edges, but the outer one, and the half-edges across their edges.
+     */
+    void collect_triangles(const QuadEdges &edges)
+    {
+        std::vector<std::size_t> half_edge(edges.size(), none);
+        m_triangles.reserve(edges.size() / 2);
+        for (std::size_t e = 0; e < edges.size(); ++e)
+        {
+            if (e % 2 || edges.deleted(e) || half_edge[e] != none) continue;
+            std::size_t e1 = edges.lnext(e), e2 = edges.lnext(e1);
+            if (edges.lnext(e2) != e || orient(edges.org(e), edges.org(e1), edges.org(e2)) <= 0) continue;
+            std::size_t t = m_triangles.size();
+            m_triangles.insert(m_triangles.end(), {edges.org(e), edges.org(e1), edges.org(e2)});
+            half_edge[e] = t;
+            half_edge[e1] = t + 1;
+            half_edge[e2] = t + 2;
+        }
+
+        m_halfedges.assign(m_triangles.size(), none);
+        for (std::size_t e = 0; e < edges.size(); ++e)
+        {
+            if (half_edge[e] != none) m_halfedges[half_edge[e]] = half_edge[QuadEdges::sym(e)];
+        }
+    }
+
+    /**
+     * Replaces point i by order[i] everywhere.
+     */
+    void renumber(const std::vector<std::size_t> &order)
+    {
+        for (std::size_t &v : m_triangles) v = order[v];
+        for (std::size_t &v : m_hull) v = order[v];
+        for (std::size_t &v : m_chain) v = order[v];
+        std::vector<std::size_t> same_as(order.size(), none);
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            if (m_same_as[i] != none) same_as[order[i]] = order[m_same_as[i]];
+        }
+        m_same_as = std::move(same_as);
+    }
+
+    PointSet m_points;
+    std::vector<std::size_t> m_same_as; // Point of which each point is a copy, or none.
+    std::vector<std::size_t> m_triangles;
+    std::vector<std::size_t> m_halfedges;
+    std::vector<std::size_t> m_hull;
+    std::vector<std::size_t> m_chain; // The points in order, when they are all on one line.
+};
+
+#endif //UNTITLED_DELAUNAY_H
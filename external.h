@@ -0,0 +1,414 @@
+//
+// Created by bruno on 24/01/18.
+//
+
+#ifndef UNTITLED_EXTERNAL_H
+#define UNTITLED_EXTERNAL_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "lecture2.h"
+#include "lecture3.h"
+#include "pointset_io.h"
+
+// Out-of-core algorithms, for point files larger than memory. The points are read in chunks of a fixed
+// number of points, and memory stays a small multiple of one chunk.
+// - Convex hull: the hull of the points read so far is merged with the hull of each chunk. Only the
+//   running hull is kept between chunks.
+// - Closest pair: the points are sorted on x with an external merge sort (sorted runs of one chunk each
+//   in temporary files, merged in one pass), then taken in slabs of one chunk in x order, each with its
+//   own closest pair. The slabs are then merged two by two, as in a merge sort, into runs sorted on y in
+//   temporary files; each merge also checks the pairs across the boundary between its two runs, as the
+//   strip of closest_pair, in the same pass. O(n log(n / chunk)) points read and written, however close
+//   the points are on x, and only the merge buffers in memory.
+
+/**
+ * Reads a point file (text, see parse_pointset, or binary, see MappedPointSet) a chunk at a time.
+ */
+class PointStream
+{
+public:
+    explicit PointStream(const std::string &path)
+        : m_in(path, std::ios::binary), m_binary(is_point_file(path))
+    {
+        if (!m_in) {
+            std::cerr << "cannot open \"" << path << "\".\n";
+            std::abort();
+        }
+        if (m_binary) {
+            m_in.read(reinterpret_cast<char *>(&m_header), sizeof(m_header));
+            if (!m_in || m_header.version != PointFileHeader::current_version) {
+                std::cerr << "\"" << path << "\" is not a valid point file.\n";
+                std::abort();
+            }
+        }
+    }
+
+    /**
+     * Whether the points come sorted on the x-coord (binary files saved so).
+     */
+    bool sorted_by_x() const { return m_binary && (m_header.flags & PointFileHeader::sorted_by_x) != 0; }
+
+    /**
+     * Replaces the contents of chunk with the next points, at most max_points of them.
+     * Returns false once there are no more points.
+     */
+    bool read(PointSet &chunk, std::size_t max_points)
+    {
+        chunk.clear();
+        if (m_binary) {
+            read_binary(chunk, max_points);
+        } else {
+            read_text(chunk, max_points);
+        }
+        return !chunk.empty();
+    }
+
+private:
+    void read_binary(PointSet &chunk, std::size_t max_points)
+    {
+        std::size_t n = std::min<std::size_t>(max_points, m_header.count - m_next);
+        m_column.resize(n);
+        chunk.resize(n);
+
+        // x-coords, then y-coords: two reads per chunk.
+        for (std::size_t column = 0; column < 2; ++column)
+        {
+            m_in.seekg(sizeof(PointFileHeader) + (column * m_header.count + m_next) * sizeof(double));
+            m_in.read(reinterpret_cast<char *>(m_column.data()), n * sizeof(double));
+            for (std::size_t i = 0; i < n; ++i) (column ? chunk[i].y : chunk[i].x) = m_column[i];
+        }
+        if (!m_in) {
+            std::cerr << "point file truncated.\n";
+            std::abort();
+        }
+        m_next += n;
+    }
+
+    void read_text(PointSet &chunk, std::size_t max_points)
+    {
+        // m_buffer[m_pos, m_end) is text read but not parsed yet.
+        while (!m_done && chunk.size() < max_points)
+        {
+            const char *first = m_buffer.data() + m_pos;
+            const char *last = m_buffer.data() + m_end;
+            const char *nl = static_cast<const char *>(std::memchr(first, '\n', last - first));
+
+            if (!nl && !m_in.eof()) {
+                // Move the partial line to the front, and read more after it.
+                std::copy(first, last, m_buffer.begin());
+                m_end -= m_pos;
+                m_pos = 0;
+                if (m_end == m_buffer.size()) m_buffer.resize(2 * m_buffer.size());
+                m_in.read(m_buffer.data() + m_end, m_buffer.size() - m_end);
+                m_end += m_in.gcount();
+                continue;
+            }
+
+            const char *line_end = nl ? nl : last;
+            Point p;
+            // As parse_pointset, stop at the first line which doesn't hold a point.
+            if (first == last || !parse_point(first, line_end, p)) {
+                m_done = true;
+                break;
+            }
+            chunk.push_back(p);
+            m_pos = nl ? nl + 1 - m_buffer.data() : m_end;
+        }
+    }
+
+    std::ifstream m_in;
+    bool m_binary;
+
+    PointFileHeader m_header{};
+    std::size_t m_next = 0; // Index of the next point of a binary file.
+    std::vector<double> m_column;
+
+    std::vector<char> m_buffer = std::vector<char>(1 << 20);
+    std::size_t m_pos = 0;
+    std::size_t m_end = 0;
+    bool m_done = false;
+};
+
+// Default number of points per chunk: 16MB of points.
+constexpr std::size_t default_chunk_points = std::size_t(1) << 20;
+
+namespace problem3 {
+
+/**
+ * Convex hull of the points of a point file, read chunk_points at a time: same result as parallel_hull
+ * of all the points, counter-clockwise from graham_scan's pivot.
+ */
+inline PointSet external_hull(const std::string &path, std::size_t chunk_points = default_chunk_points)
+{
+    PointStream stream(path);
+    PointSet chunk;
+    PointSet hull;
+    while (stream.read(chunk, chunk_points))
+    {
+        // The hull of the chunk first: the Akl-Toussaint filter discards most of it, in parallel.
+        PointSet chunk_hull = parallel_hull(chunk);
+        hull.insert(hull.end(), chunk_hull.begin(), chunk_hull.end());
+        hull = monotone_chain(std::move(hull));
+    }
+    start_at_pivot(hull);
+    return hull;
+}
+
+} // end namespace problem3
+
+namespace problem4 {
+
+/**
+ * Temporary file of raw points, removed when closed.
+ */
+class TempPointFile
+{
+public:
+    TempPointFile() : m_file(std::tmpfile(), &std::fclose)
+    {
+        if (!m_file) {
+            std::cerr << "cannot create a temporary file: " << std::strerror(errno) << ".\n";
+            std::abort();
+        }
+    }
+
+    void write(const Point *points, std::size_t n)
+    {
+        if (std::fwrite(points, sizeof(Point), n, m_file.get()) != n) {
+            std::cerr << "cannot write a temporary file: " << std::strerror(errno) << ".\n";
+            std::abort();
+        }
+    }
+
+    /**
+     * Reads up to n points. Returns the number read.
+     */
+    std::size_t read(Point *points, std::size_t n)
+    {
+        return std::fread(points, sizeof(Point), n, m_file.get());
+    }
+
+    void rewind() { std::rewind(m_file.get()); }
+
+private:
+    std::unique_ptr<std::FILE, int (*)(std::FILE *)> m_file;
+};
+
+/**
+ * Sorts the points of stream on x-coord into a temporary file, keeping about 2 chunks of points in memory.
+ */
+inline TempPointFile external_sort_on_x(PointStream &stream, std::size_t chunk_points)
+{
+    auto x_less = [](Point a, Point b) { return a.x < b.x; };
+
+    // Sorted runs of one chunk each.
+    std::vector<TempPointFile> runs;
+    PointSet chunk;
+    while (stream.read(chunk, chunk_points))
+    {
+        std::sort(chunk.begin(), chunk.end(), x_less);
+        runs.emplace_back().write(chunk.data(), chunk.size());
+    }
+
+    if (runs.size() == 1) {
+        runs.front().rewind();
+        return std::move(runs.front());
+    }
+
+    // k-way merge, with a buffer of equal share for each run.
+    struct Run
+    {
+        PointSet buffer;
+        std::size_t pos = 0;
+    };
+    std::size_t buffer_points = std::max<std::size_t>(1024, chunk_points / std::max<std::size_t>(1, runs.size()));
+    std::vector<Run> buffers(runs.size());
+    auto refill = [&](std::size_t r) {
+        Run &run = buffers[r];
+        run.buffer.resize(buffer_points);
+        run.buffer.resize(runs[r].read(run.buffer.data(), buffer_points));
+        run.pos = 0;
+        return !run.buffer.empty();
+    };
+
+    struct Head
+    {
+        Point p;
+        std::size_t run;
+        bool operator >(const Head &rhs) const { return p.x > rhs.p.x; }
+    };
+    std::priority_queue<Head, std::vector<Head>, std::greater<>> heads;
+    for (std::size_t r = 0; r < runs.size(); ++r)
+    {
+        runs[r].rewind();
+        if (refill(r)) heads.push({buffers[r].buffer[0], r});
+    }
+
+    TempPointFile sorted;
+    PointSet out;
+    out.reserve(buffer_points);
+    while (!heads.empty())
+    {
+        Head head = heads.top();
+        heads.pop();
+        out.push_back(head.p);
+        if (out.size() == buffer_points) {
+            sorted.write(out.data(), out.size());
+            out.clear();
+        }
+
+        Run &run = buffers[head.run];
+        if (++run.pos < run.buffer.size() || refill(head.run)) {
+            heads.push({run.buffer[run.pos], head.run});
+        }
+    }
+    sorted.write(out.data(), out.size());
+    sorted.rewind();
+    return sorted;
+}
+
+/**
+ * Points of consecutive slabs, between min_x and max_x, sorted on y-coord in a temporary file.
+ */
+struct RunOnY
+{
+    TempPointFile file;
+    double min_x;
+    double max_x;
+    std::size_t slabs;
+};
+
+/**
+ * Merges two runs on y, the points of left all left of those of right, into a new run. On the way, checks
+ * the pairs across the boundary between them against closest, as the strip of closest_pair: each point
+ * closer to the boundary than the closest distance, against the previous ones less than that below it.
+ * Those are few: the points of each run are at least that far apart. Keeps about 3 buffers of
+ * buffer_points points in memory.
+ */
+inline RunOnY merge_runs_on_y(RunOnY &left, RunOnY &right, ClosestPairResult &closest, std::size_t buffer_points)
+{
+    RunOnY merged{TempPointFile(), left.min_x, right.max_x, left.slabs + right.slabs};
+    double boundary = right.min_x;
+
+    struct Input
+    {
+        TempPointFile &file;
+        PointSet buffer;
+        std::size_t pos = 0;
+
+        bool refill(std::size_t n)
+        {
+            buffer.resize(n);
+            buffer.resize(file.read(buffer.data(), n));
+            pos = 0;
+            return !buffer.empty();
+        }
+    };
+    Input inputs[] = {{left.file, {}}, {right.file, {}}};
+    for (Input &in : inputs)
+    {
+        in.file.rewind();
+        in.refill(buffer_points);
+    }
+
+    std::deque<Point> window; // Points of the strip less than the closest distance below the current one.
+    PointSet out;
+    out.reserve(buffer_points);
+    while (true)
+    {
+        bool has_left = inputs[0].pos < inputs[0].buffer.size() || inputs[0].refill(buffer_points);
+        bool has_right = inputs[1].pos < inputs[1].buffer.size() || inputs[1].refill(buffer_points);
+        if (!has_left && !has_right) break;
+        Input &in = !has_right || (has_left && inputs[0].buffer[inputs[0].pos].y <= inputs[1].buffer[inputs[1].pos].y)
+                        ? inputs[0] : inputs[1];
+        Point p = in.buffer[in.pos++];
+
+        out.push_back(p);
+        if (out.size() == buffer_points) {
+            merged.file.write(out.data(), out.size());
+            out.clear();
+        }
+
+        if ((p.x - boundary) * (p.x - boundary) >= closest.squared_distance) continue;
+        while (!window.empty() && (p.y - window.front().y) * (p.y - window.front().y) >= closest.squared_distance)
+        {
+            window.pop_front();
+        }
+        for (Point q : window) closest = std::min(closest, ClosestPairResult{q, p});
+        window.push_back(p);
+    }
+    merged.file.write(out.data(), out.size());
+    return merged;
+}
+
+/**
+ * Closest pair of the points of a point file, read chunk_points at a time: same distance as closest_pair
+ * of all the points (and the same pair, but for ties). Files saved sorted on x skip the external sort.
+ */
+inline ClosestPairResult external_closest_pair(const std::string &path, std::size_t chunk_points = default_chunk_points)
+{
+    PointStream stream(path);
+
+    // The points in x order, one slab at a time.
+    TempPointFile sorted;
+    bool presorted = stream.sorted_by_x();
+    if (!presorted) {
+        sorted = external_sort_on_x(stream, chunk_points);
+    }
+    auto next_slab = [&](PointSet &slab) {
+        if (presorted) return stream.read(slab, chunk_points);
+        slab.resize(chunk_points);
+        slab.resize(sorted.read(slab.data(), chunk_points));
+        return !slab.empty();
+    };
+
+    ClosestPairWorkspace ws;
+    WorkStealingPool pool;
+    ClosestPairResult closest;
+    std::size_t buffer_points = std::max<std::size_t>(1024, chunk_points / 4);
+
+    // Runs of consecutive slabs in x order, as the carries of a binary counter: each one holds twice as
+    // many slabs as the next, but for the last two, merged as soon as they hold as many.
+    std::vector<RunOnY> runs;
+    PointSet slab;
+    while (next_slab(slab))
+    {
+        RunOnY run{TempPointFile(), slab.front().x, slab.back().x, 1};
+        closest = std::min(closest, closest_pair_parallel(range(slab.begin(), slab.end()), ws, pool, true));
+        // closest_pair_parallel leaves the points sorted on y in ws.by_y.
+        run.file.write(ws.by_y.data(), slab.size());
+        runs.push_back(std::move(run));
+
+        while (runs.size() > 1 && runs[runs.size() - 2].slabs == runs.back().slabs)
+        {
+            RunOnY merged = merge_runs_on_y(runs[runs.size() - 2], runs.back(), closest, buffer_points);
+            runs.pop_back();
+            runs.back() = std::move(merged);
+        }
+    }
+    while (runs.size() > 1)
+    {
+        RunOnY merged = merge_runs_on_y(runs[runs.size() - 2], runs.back(), closest, buffer_points);
+        runs.pop_back();
+        runs.back() = std::move(merged);
+    }
+    return closest;
+}
+
+} // end namespace problem4
+
+#endif //UNTITLED_EXTERNAL_H
@@ -0,0 +1,290 @@
+//
+// Created by bruno on 23/01/18.
+//
+
+#ifndef UNTITLED_INSTRUMENT_H
+#define UNTITLED_INSTRUMENT_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// Instrumentation of the hot paths: time spent in each phase of the algorithms, and counts of their operations.
+// - Only compiled in with ALGOS_INSTRUMENT defined (cmake -DINSTRUMENT=ON). Otherwise the INSTRUMENT_* macros
+//   expand to nothing, and the algorithms are exactly as fast as without them.
+// - Each thread counts in its own block, with plain (relaxed) loads and stores: no contention, no locked
+//   instructions. A snapshot sums the blocks of all the threads, including those which have exited.
+// - Phase times are summed over the threads too: for parallel algorithms they are CPU time, not wall time.
+
+namespace instrument {
+
+#ifdef ALGOS_INSTRUMENT
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+enum class Phase
+{
+    sort,   // Sorting points (on angle, on x...).
+    scan,   // Going over sorted points: Graham's stack, closest pair strips.
+    merge,  // Merging sorted ranges.
+    filter, // Selecting points: closest pair strips, hull prefilters.
+};
+
+enum class Counter
+{
+    predicate_calls,       // Orientation and incircle tests.
+    exact_predicate_calls, // Those which needed the exact evaluation.
+    comparisons,           // Calls of sort comparators.
+    distance_checks,       // Candidate pairs whose distance was computed.
+    stack_pops,            // Points popped off the stack of a hull scan.
+    strips,                // Strips built by closest pair.
+    strip_points,          // Points in those strips.
+    max_strip,             // Points in the largest strip (a maximum, not a sum).
+    allocations,           // Buffers allocated by the algorithms.
+    allocated_bytes,       // Their size.
+};
+
+constexpr std::size_t phase_count = 4;
+constexpr std::size_t counter_count = 10;
+
+constexpr const char *phase_names[phase_count] = {"sort", "scan", "merge", "filter"};
+constexpr const char *counter_names[counter_count] = {
+    "predicate_calls", "exact_predicate_calls", "comparisons", "distance_checks", "stack_pops",
+    "strips", "strip_points", "max_strip", "allocations", "allocated_bytes",
+};
+
+/**
+ * Values recorded since the last reset.
+ */
+struct Stats
+{
+    std::array<std::uint64_t, phase_count> phase_ns{};
+    std::array<std::uint64_t, phase_count> phase_calls{};
+    std::array<std::uint64_t, counter_count> counters{};
+
+    std::uint64_t operator [](Counter c) const { return counters[static_cast<std::size_t>(c)]; }
+
+    std::chrono::nanoseconds time(Phase p) const
+    {
+        return std::chrono::nanoseconds(phase_ns[static_cast<std::size_t>(p)]);
+    }
+
+    std::uint64_t calls(Phase p) const { return phase_calls[static_cast<std::size_t>(p)]; }
+
+    /**
+     * Adds the values of other (or takes their maximum, for maxima).
+     */
+    void accumulate(const Stats &other)
+    {
+        for (std::size_t i = 0; i < phase_count; ++i)
+        {
+            phase_ns[i] += other.phase_ns[i];
+            phase_calls[i] += other.phase_calls[i];
+        }
+        for (std::size_t i = 0; i < counter_count; ++i)
+        {
+            counters[i] = is_maximum(static_cast<Counter>(i)) ? std::max(counters[i], other.counters[i])
+                                                              : counters[i] + other.counters[i];
+        }
+    }
+
+    static constexpr bool is_maximum(Counter c) { return c == Counter::max_strip; }
+};
+
+/**
+ * Writes stats as a JSON object: {"phases": {"sort": {"ns": ..., "calls": ...}, ...}, "counters": {...}}.
+ */
+inline void dump(std::ostream &out, const Stats &stats)
+{
+    out << "{\"phases\": {";
+    for (std::size_t i = 0; i < phase_count; ++i)
+    {
+        out << (i ? ", " : "") << '"' << phase_names[i] << "\": {\"ns\": " << stats.phase_ns[i]
+            << ", \"calls\": " << stats.phase_calls[i] << '}';
+    }
+    out << "}, \"counters\": {";
+    for (std::size_t i = 0; i < counter_count; ++i)
+    {
+        out << (i ? ", " : "") << '"' << counter_names[i] << "\": " << stats.counters[i];
+    }
+    out << "}}";
+}
+
+namespace detail {
+
+/**
+ * Values of one thread. Only that thread writes them; other threads may read them at any time.
+ */
+struct ThreadStats
+{
+    std::array<std::atomic<std::uint64_t>, phase_count> phase_ns{};
+    std::array<std::atomic<std::uint64_t>, phase_count> phase_calls{};
+    std::array<std::atomic<std::uint64_t>, counter_count> counters{};
+
+    ThreadStats();
+    ~ThreadStats();
+
+    static void add(std::atomic<std::uint64_t> &v, std::uint64_t n)
+    {
+        v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    Stats load() const
+    {
+        Stats s;
+        for (std::size_t i = 0; i < phase_count; ++i)
+        {
+            s.phase_ns[i] = phase_ns[i].load(std::memory_order_relaxed);
+            s.phase_calls[i] = phase_calls[i].load(std::memory_order_relaxed);
+        }
+        for (std::size_t i = 0; i < counter_count; ++i)
+        {
+            s.counters[i] = counters[i].load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+
+    void clear()
+    {
+        for (auto &v : phase_ns) v.store(0, std::memory_order_relaxed);
+        for (auto &v : phase_calls) v.store(0, std::memory_order_relaxed);
+        for (auto &v : counters) v.store(0, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * The blocks of the running threads, and the sum of those of the threads which have exited.
+ */
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<ThreadStats *> threads;
+    Stats exited;
+};
+
+inline Registry &registry()
+{
+    static Registry r;
+    return r;
+}
+
+inline ThreadStats::ThreadStats()
+{
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.threads.push_back(this);
+}
+
+inline ThreadStats::~ThreadStats()
+{
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.exited.accumulate(load());
+    r.threads.erase(std::find(r.threads.begin(), r.threads.end(), this));
+}
+
+inline ThreadStats &local()
+{
+    thread_local ThreadStats stats;
+    return stats;
+}
+
+} // end namespace detail
+
+inline void count(Counter c, std::uint64_t n = 1)
+{
+    detail::ThreadStats::add(detail::local().counters[static_cast<std::size_t>(c)], n);
+}
+
+/**
+ * Raises counter c (a maximum) to n if it is smaller.
+ */
+inline void record_max(Counter c, std::uint64_t n)
+{
+    auto &v = detail::local().counters[static_cast<std::size_t>(c)];
+    if (n > v.load(std::memory_order_relaxed)) v.store(n, std::memory_order_relaxed);
+}
+
+/**
+ * Adds the time from its construction to its destruction to a phase.
+ * Phases should not be nested, or the inner time is counted twice.
+ */
+class ScopedPhase
+{
+public:
+    explicit ScopedPhase(Phase p) : m_phase(static_cast<std::size_t>(p)), m_start(std::chrono::steady_clock::now()) {}
+
+    ScopedPhase(const ScopedPhase &) = delete;
+    ScopedPhase &operator =(const ScopedPhase &) = delete;
+
+    ~ScopedPhase()
+    {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start);
+        detail::ThreadStats &stats = detail::local();
+        detail::ThreadStats::add(stats.phase_ns[m_phase], static_cast<std::uint64_t>(ns.count()));
+        detail::ThreadStats::add(stats.phase_calls[m_phase], 1);
+    }
+
+private:
+    std::size_t m_phase;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+/**
+ * Sum of the values of all the threads since the last reset.
+ * Values of threads running an algorithm at the time may be partial.
+ */
+inline Stats snapshot()
+{
+    detail::Registry &r = detail::registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    Stats total = r.exited;
+    for (const detail::ThreadStats *t : r.threads)
+    {
+        total.accumulate(t->load());
+    }
+    return total;
+}
+
+/**
+ * Sets every value to 0. Should be called while no algorithm is running.
+ */
+inline void reset()
+{
+    detail::Registry &r = detail::registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.exited = Stats{};
+    for (detail::ThreadStats *t : r.threads)
+    {
+        t->clear();
+    }
+}
+
+} // end namespace instrument
+
+#ifdef ALGOS_INSTRUMENT
+#define INSTRUMENT_CONCAT_IMPL(a, b) a##b
+#define INSTRUMENT_CONCAT(a, b) INSTRUMENT_CONCAT_IMPL(a, b)
+#define INSTRUMENT_COUNT(counter, n) ::instrument::count(::instrument::Counter::counter, (n))
+#define INSTRUMENT_MAX(counter, n) ::instrument::record_max(::instrument::Counter::counter, (n))
+#define INSTRUMENT_ALLOC(bytes) \
+    (::instrument::count(::instrument::Counter::allocations), \
+     ::instrument::count(::instrument::Counter::allocated_bytes, (bytes)))
+// Times the rest of the enclosing block.
+#define INSTRUMENT_PHASE(phase) \
+    ::instrument::ScopedPhase INSTRUMENT_CONCAT(instrument_phase_, __LINE__){::instrument::Phase::phase}
+#else
+#define INSTRUMENT_COUNT(counter, n) ((void)0)
+#define INSTRUMENT_MAX(counter, n) ((void)0)
+#define INSTRUMENT_ALLOC(bytes) ((void)0)
+#define INSTRUMENT_PHASE(phase) ((void)0)
+#endif
+
+#endif //UNTITLED_INSTRUMENT_H
@@ -0,0 +1,294 @@
+//
+// Created by bruno on 20/01/18.
+//
+
+#ifndef UNTITLED_KDTREE_H
+#define UNTITLED_KDTREE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+#include "parallel.h"
+
+// Static 2-d tree over a point set, for nearest neighbours and radius queries against fixed points.
+// - Implicit layout: the tree is the points themselves, reordered. The node of a range [lo, hi) is the
+//   median point at mid = (lo + hi) / 2 on x or y (alternating with depth), with its left subtree in
+//   [lo, mid) and its right subtree in (mid, hi). No nodes, no pointers: only the arrays of coordinates.
+// - Ranges of up to leaf_size points aren't split further and are scanned.
+// - Built with nth_element on each range, the two halves in parallel above a cutoff: O(n log n).
+// - Batched queries are taken in Morton (Z-curve) order in blocks: queries close in space are handled
+//   one after the other on the same thread, and find the part of the tree they walk in the caches.
+
+class KdTree
+{
+public:
+    struct Neighbor
+    {
+        std::size_t index; // In the point set given to the constructor.
+        double squared_distance;
+    };
+
+    /**
+     * Points within a radius of each query: those of query q are indices[offsets[q]...offsets[q + 1]).
+     */
+    struct RadiusResult
+    {
+        std::vector<std::size_t> offsets;
+        std::vector<std::size_t> indices;
+    };
+
+    static constexpr std::size_t leaf_size = 8;
+
+    explicit KdTree(const PointSet &ps, unsigned threads = hardware_threads())
+    {
+        std::vector<Item> items(ps.size());
+        for (std::size_t i = 0; i < ps.size(); ++i) items[i] = Item{ps[i], i};
+
+        WorkStealingPool pool(threads);
+        build(items, pool, 0, items.size(), 0);
+
+        m_x.resize(items.size());
+        m_y.resize(items.size());
+        m_index.resize(items.size());
+        for (std::size_t i = 0; i < items.size(); ++i)
+        {
+            m_x[i] = items[i].p.x;
+            m_y[i] = items[i].p.y;
+            m_index[i] = items[i].index;
+        }
+    }
+
+    std::size_t size() const { return m_index.size(); }
+
+    /**
+     * The (up to) k points closest to q, closest first, in out.
+     */
+    void nearest(Point q, std::size_t k, std::vector<Neighbor> &out) const
+    {
+        out.clear();
+        if (k == 0) return;
+        nearest(q, k, 0, size(), 0, out);
+        std::sort_heap(out.begin(), out.end(), closer);
+    }
+
+    /**
+     * The points at most r from q, in no particular order, appended to out.
+     */
+    void within(Point q, double r, std::vector<std::size_t> &out) const
+    {
+        within(q, r * r, 0, size(), 0, out);
+    }
+
+    /**
+     * nearest for each query: the neighbours of query q are at [q * k', (q + 1) * k'), for k' = min(k, size()).
+     */
+    std::vector<Neighbor> nearest(const PointSet &queries, std::size_t k, unsigned threads = hardware_threads()) const
+    {
+        k = std::min(k, size());
+        std::vector<Neighbor> res(queries.size() * k);
+        for_each_block(queries, threads, [&](const std::size_t *order, std::size_t count) {
+            std::vector<Neighbor> found;
+            found.reserve(k);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                nearest(queries[order[i]], k, found);
+                std::copy(found.begin(), found.end(), res.begin() + order[i] * k);
+            }
+        });
+        return res;
+    }
+
+    /**
+     * within for each query.
+     */
+    RadiusResult within(const PointSet &queries, double r, unsigned threads = hardware_threads()) const
+    {
+        // Each block collects its results on its own, then they are laid out in query order.
+        std::vector<std::size_t> counts(queries.size());
+        std::vector<std::vector<std::size_t>> block_indices;
+        std::vector<std::vector<std::size_t>> block_offsets;
+        std::size_t blocks = (queries.size() + block_size - 1) / block_size;
+        block_indices.resize(blocks);
+        block_offsets.resize(blocks);
+
+        std::vector<std::size_t> order = morton_order(queries);
+        parallel_for(blocks, [&](std::size_t b) {
+            for (std::size_t i = b * block_size, end = std::min(queries.size(), i + block_size); i < end; ++i)
+            {
+                std::size_t before = block_indices[b].size();
+                block_offsets[b].push_back(before);
+                within(queries[order[i]], r, block_indices[b]);
+                counts[order[i]] = block_indices[b].size() - before;
+            }
+        }, threads);
+
+        RadiusResult res;
+        res.offsets.resize(queries.size() + 1, 0);
+        for (std::size_t q = 0; q < queries.size(); ++q)
+        {
+            res.offsets[q + 1] = res.offsets[q] + counts[q];
+        }
+        res.indices.resize(res.offsets.back());
+        parallel_for(blocks, [&](std::size_t b) {
+            for (std::size_t i = b * block_size, end = std::min(queries.size(), i + block_size); i < end; ++i)
+            {
+                std::size_t q = order[i];
+                auto first = block_indices[b].begin() + block_offsets[b][i - b * block_size];
+                std::copy(first, first + counts[q], res.indices.begin() + res.offsets[q]);
+            }
+        }, threads);
+        return res;
+    }
+
+private:
+    struct Item
+    {
+        Point p;
+        std::size_t index;
+    };
+
+    // Ranges bigger than this are built in parallel.
+    static constexpr std::size_t parallel_cutoff = 1 << 14;
+    // Queries per task of the batched queries.
+    static constexpr std::size_t block_size = 256;
+
+    static bool closer(const Neighbor &a, const Neighbor &b) { return a.squared_distance < b.squared_distance; }
+
+    static void build(std::vector<Item> &items, WorkStealingPool &pool, std::size_t lo, std::size_t hi, unsigned depth)
+    {
+        if (hi - lo <= leaf_size) return;
+
+        std::size_t mid = lo + (hi - lo) / 2;
+        std::nth_element(items.begin() + lo, items.begin() + mid, items.begin() + hi, [depth](const Item &a, const Item &b) {
+            return depth % 2 == 0 ? a.p.x < b.p.x : a.p.y < b.p.y;
+        });
+
+        auto left = [&] { build(items, pool, lo, mid, depth + 1); };
+        auto right = [&] { build(items, pool, mid + 1, hi, depth + 1); };
+        if (hi - lo > parallel_cutoff) {
+            pool.fork_join(left, right);
+        } else {
+            left();
+            right();
+        }
+    }
+
+    double squared_distance(Point q, std::size_t i) const
+    {
+        double dx = m_x[i] - q.x;
+        double dy = m_y[i] - q.y;
+        return dx * dx + dy * dy;
+    }
+
+    /**
+     * Keeps the k closest points in out, as a max-heap on the distance.
+     */
+    void nearest(Point q, std::size_t k, std::size_t lo, std::size_t hi, unsigned depth, std::vector<Neighbor> &out) const
+    {
+        auto consider = [&](std::size_t i) {
+            double d = squared_distance(q, i);
+            if (out.size() < k) {
+                out.push_back(Neighbor{m_index[i], d});
+                std::push_heap(out.begin(), out.end(), closer);
+            } else if (d < out.front().squared_distance) {
+                std::pop_heap(out.begin(), out.end(), closer);
+                out.back() = Neighbor{m_index[i], d};
+                std::push_heap(out.begin(), out.end(), closer);
+            }
+        };
+
+        if (hi - lo <= leaf_size) {
+            for (std::size_t i = lo; i < hi; ++i) consider(i);
+            return;
+        }
+
+        std::size_t mid = lo + (hi - lo) / 2;
+        consider(mid);
+
+        double diff = depth % 2 == 0 ? q.x - m_x[mid] : q.y - m_y[mid];
+        if (diff < 0) {
+            nearest(q, k, lo, mid, depth + 1, out);
+            if (out.size() < k || diff * diff < out.front().squared_distance) nearest(q, k, mid + 1, hi, depth + 1, out);
+        } else {
+            nearest(q, k, mid + 1, hi, depth + 1, out);
+            if (out.size() < k || diff * diff < out.front().squared_distance) nearest(q, k, lo, mid, depth + 1, out);
+        }
+    }
+
+    void within(Point q, double r2, std::size_t lo, std::size_t hi, unsigned depth, std::vector<std::size_t> &out) const
+    {
+        if (hi - lo <= leaf_size) {
+            for (std::size_t i = lo; i < hi; ++i)
+            {
+                if (squared_distance(q, i) <= r2) out.push_back(m_index[i]);
+            }
+            return;
+        }
+
+        std::size_t mid = lo + (hi - lo) / 2;
+        if (squared_distance(q, mid) <= r2) out.push_back(m_index[mid]);
+
+        double diff = depth % 2 == 0 ? q.x - m_x[mid] : q.y - m_y[mid];
+        if (diff <= 0 || diff * diff <= r2) within(q, r2, lo, mid, depth + 1, out);
+        if (diff >= 0 || diff * diff <= r2) within(q, r2, mid + 1, hi, depth + 1, out);
+    }
+
+    /**
+     * Indices of the queries sorted on their position along a Z-curve over their bounding box.
+     */
+    static std::vector<std::size_t> morton_order(const PointSet &queries)
+    {
+        std::vector<std::size_t> order(queries.size());
+        if (queries.empty()) return order;
+
+        Point min = queries[0], max = queries[0];
+        for (Point p : queries)
+        {
+            min = Point{std::min(min.x, p.x), std::min(min.y, p.y)};
+            max = Point{std::max(max.x, p.x), std::max(max.y, p.y)};
+        }
+
+        // Spreads the bits of a 16-bit value to the even positions.
+        auto spread = [](std::uint32_t v) {
+            v = (v | (v << 8)) & 0x00FF00FF;
+            v = (v | (v << 4)) & 0x0F0F0F0F;
+            v = (v | (v << 2)) & 0x33333333;
+            v = (v | (v << 1)) & 0x55555555;
+            return v;
+        };
+        auto cell = [](double v, double lo, double hi) {
+            return hi > lo ? static_cast<std::uint32_t>((v - lo) / (hi - lo) * 65535.0) : 0u;
+        };
+
+        std::vector<std::pair<std::uint32_t, std::size_t>> keys(queries.size());
+        for (std::size_t i = 0; i < queries.size(); ++i)
+        {
+            Point p = queries[i];
+            keys[i] = {spread(cell(p.x, min.x, max.x)) | spread(cell(p.y, min.y, max.y)) << 1, i};
+        }
+        std::sort(keys.begin(), keys.end());
+        for (std::size_t i = 0; i < keys.size(); ++i) order[i] = keys[i].second;
+        return order;
+    }
+
+    /**
+     * Calls fn(order, count) for blocks of consecutive queries in Morton order, over the threads.
+     */
+    template <class Fn>
+    static void for_each_block(const PointSet &queries, unsigned threads, Fn &&fn)
+    {
+        std::vector<std::size_t> order = morton_order(queries);
+        parallel_for((queries.size() + block_size - 1) / block_size, [&](std::size_t b) {
+            std::size_t first = b * block_size;
+            fn(order.data() + first, std::min(block_size, queries.size() - first));
+        }, threads);
+    }
+
+    std::vector<double> m_x;
+    std::vector<double> m_y;
+    std::vector<std::size_t> m_index; // Of each point in the original point set.
+};
+
+#endif //UNTITLED_KDTREE_H
@@ -3,14 +3,19 @@
 //
 
 #include "common.h"
+#include "lecture1.h"
+#include "instrument.h"
+#include "predicates.h"
 #include <algorithm>
 #include <tuple>
 #include <iostream>
 #include <string>
-#include <string_view>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 using namespace std::string_literals;
-using namespace std::string_view_literals;
 
 // Problem 1: determining if two line segments intersect
 
@@ -26,16 +31,45 @@ using namespace std::string_view_literals;
 
 // Subproblem 1:
 
-bool on_opposite_sides(Point a, Point b, Line l)
+//equation of line l is (l.p2.x - l.p1.x)(y - l.p1.y) - (l.p2.y - l.p1.y)(x - l.p1.x) = 0.
+
+//a and b lie on opposite sides of l if and only if LHS has opposite signs when substituted with each of a and b
+//(or is 0 for either). The LHS is an orientation test: its sign must be exact (see predicates.h).
+
+namespace {
+
+PREDICATES_NOINLINE bool on_opposite_sides_exact(Point a, Point b, Line l)
 {
-    //equation of line l is (l.p2.x - l.p1.x)(y - l.p1.y) - (l.p2.y - l.p1.y)(x - l.p1.x) = 0.
+    double g = predicates::orient2d(l.p1, l.p2, a);
+    double h = predicates::orient2d(l.p1, l.p2, b);
+
+    return !(g > 0 && h > 0) && !(g < 0 && h < 0);
+}
 
-    //a and b lie on opposite sides of l if and only if LHS has opposite signs when substituted with each of a and b.
+// The filter of predicates::orient2d for both points, with the exact path out of line: small enough to be
+// inlined in intersect(), where it costs little more than the plain computation.
+inline bool on_opposite_sides_filtered(Point a, Point b, Line l)
+{
+    double gl = (l.p2.x - l.p1.x) * (a.y - l.p1.y), gr = (l.p2.y - l.p1.y) * (a.x - l.p1.x);
+    double hl = (l.p2.x - l.p1.x) * (b.y - l.p1.y), hr = (l.p2.y - l.p1.y) * (b.x - l.p1.x);
+    double g = gl - gr;
+    double h = hl - hr;
+
+    bool certain = (std::abs(g) > predicates::cross_bound * (std::abs(gl) + std::abs(gr))) &
+                   (std::abs(h) > predicates::cross_bound * (std::abs(hl) + std::abs(hr)));
+    if (certain) {
+        INSTRUMENT_COUNT(predicate_calls, 2); // The exact path counts its own.
+        // Neither is 0. No branch on the signs, which are unpredictable.
+        return std::signbit(g) != std::signbit(h);
+    }
+    return on_opposite_sides_exact(a, b, l);
+}
 
-    double g = (l.p2.x - l.p1.x) * (a.y - l.p1.y) - (l.p2.y - l.p1.y) * (a.x - l.p1.x);
-    double h = (l.p2.x - l.p1.x) * (b.y - l.p1.y) - (l.p2.y - l.p1.y) * (b.x - l.p1.x);
+}
 
-    return g * h <= 0.0;
+bool on_opposite_sides(Point a, Point b, Line l)
+{
+    return on_opposite_sides_filtered(a, b, l);
 }
 
 // Subproblem 2:
@@ -44,31 +78,18 @@ bool on_opposite_sides(Point a, Point b, Line l)
 
 bool bounding_box_collision(Line l1, Line l2)
 {
-    struct BoundingBox
-    {
-        BoundingBox(Line l)
-        {
-            std::tie(min_x, max_x) = std::minmax(l.p1.x, l.p2.x);
-            std::tie(min_y, max_y) = std::minmax(l.p1.y, l.p2.y);
-
-        }
-        double min_x;
-        double max_x;
-        double min_y;
-        double max_y;
-    };
-
-    auto bb1 = BoundingBox{l1};
-    auto bb2 = BoundingBox{l2};
-
-    return bb1.max_x >= bb2.min_x &&
-           bb1.min_x <= bb2.max_x &&
-           bb1.max_y >= bb2.min_y &&
-           bb1.min_y <= bb2.max_y;
+    return bounding_box_collision(BoundingBox{l1}, BoundingBox{l2});
 }
 
 // Putting everything together
 
+bool intersect(Line l1, Line l2)
+{
+    return on_opposite_sides_filtered(l1.p1, l1.p2, l2) &&
+           on_opposite_sides_filtered(l2.p1, l2.p2, l1) &&
+           bounding_box_collision(l1, l2);
+}
+
 bool intersect(Line l1, Line l2, bool verbose)
 {
     // Intersect if and only if:
@@ -86,46 +107,200 @@ bool intersect(Line l1, Line l2, bool verbose)
     return check1 && check2 && check3;
 }
 
-// the on_opposite_sides tests on their own are
-// sufficient to determine whether two line segments intersect,
-// except in one special case – can you find it?
+// Testing one segment against many:
+// The same three tests, applied to a whole block of segments stored as a structure of arrays.
+// All three are evaluated for every segment and combined with a bitwise and, so there are no branches,
+// and consecutive segments fill the lanes of a SIMD register (4 with AVX2, 2 with SSE2).
+// The orientation tests are filtered with one error bound for the whole block (from the largest coordinate):
+// the few lanes where a result is within it are redone with the exact predicates, one at a time.
 
-// The special case would be when the two segments are part of the same line.
-// In such case both points would satisfy the line equation for either line segment provided.
+namespace {
 
+struct Query
+{
+    double x1, y1, x2, y2;
+    double dx, dy;
+    double min_x, max_x, min_y, max_y;
+    double bound; // Orientation tests within this of 0 may have the wrong sign.
+
+    Query(Line q, double max_abs)
+        : x1(q.p1.x), y1(q.p1.y), x2(q.p2.x), y2(q.p2.y),
+          dx(q.p2.x - q.p1.x), dy(q.p2.y - q.p1.y)
+    {
+        std::tie(min_x, max_x) = std::minmax(x1, x2);
+        std::tie(min_y, max_y) = std::minmax(y1, y2);
+        max_abs = std::max({max_abs, std::abs(x1), std::abs(y1), std::abs(x2), std::abs(y2)});
+        bound = predicates::cross_static_bound(max_abs);
+    }
+};
 
-// Testing:
-Line ask_line()
+/**
+ * Bits [0, count) of the result are the intersection tests of segments [i, i + count) of segs.
+ */
+std::uint64_t intersect_scalar(const Query &q, const SegmentBlock &segs, std::size_t i, std::size_t count)
 {
-    std::cout << "Type points for line segment ( eg (1,2) (3,4) ): ";
+    Line ql{{q.x1, q.y1}, {q.x2, q.y2}};
+    std::uint64_t bits = 0;
+    for (std::size_t k = 0; k < count; ++k)
+    {
+        Line l{{segs.x1[i + k], segs.y1[i + k]}, {segs.x2[i + k], segs.y2[i + k]}};
+        bits |= std::uint64_t{intersect(ql, l)} << k;
+    }
+    return bits;
+}
 
-    double p1x, p1y, p2x, p2y;
-    std::string res;
+#if defined(__AVX2__) || defined(__SSE2__)
 
-    std::getline(std::cin, res);
-    white_strip(res);
-    if (sscanf(res.c_str(), "(%lf,%lf)(%lf,%lf)", &p1x, &p1y, &p2x, &p2y) != 4)
+/**
+ * Lane results of intersect_simd, with the uncertain lanes redone by intersect_scalar. Rarely needed: out of line.
+ */
+PREDICATES_NOINLINE std::uint64_t resolve(const Query &q, const SegmentBlock &segs, std::size_t i, std::uint64_t hits, std::uint64_t uncertain)
+{
+    hits &= ~uncertain;
+    for (; uncertain != 0; uncertain &= uncertain - 1)
     {
-        std::cerr << "error in parsing \"" << res << "\".\n";
-        std::abort();
-    };
+        unsigned k = __builtin_ctzll(uncertain);
+        hits |= intersect_scalar(q, segs, i + k, 1) << k;
+    }
+    return hits;
+}
+
+#endif
 
-    return {{p1x, p1y}, {p2x, p2y}};
+#if defined(__AVX2__)
+
+constexpr std::size_t lanes = 4;
+
+/**
+ * Same as intersect_scalar, for the 4 segments starting at i.
+ */
+std::uint64_t intersect_simd(const Query &q, const SegmentBlock &segs, std::size_t i)
+{
+    __m256d s1x = _mm256_loadu_pd(&segs.x1[i]);
+    __m256d s1y = _mm256_loadu_pd(&segs.y1[i]);
+    __m256d s2x = _mm256_loadu_pd(&segs.x2[i]);
+    __m256d s2y = _mm256_loadu_pd(&segs.y2[i]);
+    __m256d dx = _mm256_sub_pd(s2x, s1x);
+    __m256d dy = _mm256_sub_pd(s2y, s1y);
+
+    __m256d q1x = _mm256_set1_pd(q.x1), q1y = _mm256_set1_pd(q.y1);
+    __m256d q2x = _mm256_set1_pd(q.x2), q2y = _mm256_set1_pd(q.y2);
+    __m256d qdx = _mm256_set1_pd(q.dx), qdy = _mm256_set1_pd(q.dy);
+
+    __m256d g1 = _mm256_sub_pd(_mm256_mul_pd(dx, _mm256_sub_pd(q1y, s1y)), _mm256_mul_pd(dy, _mm256_sub_pd(q1x, s1x)));
+    __m256d h1 = _mm256_sub_pd(_mm256_mul_pd(dx, _mm256_sub_pd(q2y, s1y)), _mm256_mul_pd(dy, _mm256_sub_pd(q2x, s1x)));
+    __m256d g2 = _mm256_sub_pd(_mm256_mul_pd(qdx, _mm256_sub_pd(s1y, q1y)), _mm256_mul_pd(qdy, _mm256_sub_pd(s1x, q1x)));
+    __m256d h2 = _mm256_sub_pd(_mm256_mul_pd(qdx, _mm256_sub_pd(s2y, q1y)), _mm256_mul_pd(qdy, _mm256_sub_pd(s2x, q1x)));
+
+    // Past the filter, the signs are right and none is 0: opposite signs iff the sign bit of g ^ h is set.
+    __m256d abs_mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFF));
+    __m256d bound = _mm256_set1_pd(q.bound);
+    __m256d smallest = _mm256_min_pd(_mm256_min_pd(_mm256_and_pd(g1, abs_mask), _mm256_and_pd(h1, abs_mask)),
+                                     _mm256_min_pd(_mm256_and_pd(g2, abs_mask), _mm256_and_pd(h2, abs_mask)));
+    __m256d uncertain = _mm256_cmp_pd(smallest, bound, _CMP_LE_OQ);
+
+    __m256d hit = _mm256_and_pd(_mm256_xor_pd(g1, h1), _mm256_xor_pd(g2, h2));
+
+    hit = _mm256_and_pd(hit, _mm256_cmp_pd(_mm256_set1_pd(q.max_x), _mm256_min_pd(s1x, s2x), _CMP_GE_OQ));
+    hit = _mm256_and_pd(hit, _mm256_cmp_pd(_mm256_set1_pd(q.min_x), _mm256_max_pd(s1x, s2x), _CMP_LE_OQ));
+    hit = _mm256_and_pd(hit, _mm256_cmp_pd(_mm256_set1_pd(q.max_y), _mm256_min_pd(s1y, s2y), _CMP_GE_OQ));
+    hit = _mm256_and_pd(hit, _mm256_cmp_pd(_mm256_set1_pd(q.min_y), _mm256_max_pd(s1y, s2y), _CMP_LE_OQ));
+
+    auto hits = static_cast<std::uint64_t>(_mm256_movemask_pd(hit));
+    auto uncertain_lanes = static_cast<std::uint64_t>(_mm256_movemask_pd(uncertain));
+    return uncertain_lanes == 0 ? hits : resolve(q, segs, i, hits, uncertain_lanes);
 }
 
-int main(int argc, char* argv[])
+#elif defined(__SSE2__)
+
+constexpr std::size_t lanes = 2;
+
+/**
+ * Same as intersect_scalar, for the 2 segments starting at i.
+ */
+std::uint64_t intersect_simd(const Query &q, const SegmentBlock &segs, std::size_t i)
 {
-    int verbose = false;
+    __m128d s1x = _mm_loadu_pd(&segs.x1[i]);
+    __m128d s1y = _mm_loadu_pd(&segs.y1[i]);
+    __m128d s2x = _mm_loadu_pd(&segs.x2[i]);
+    __m128d s2y = _mm_loadu_pd(&segs.y2[i]);
+    __m128d dx = _mm_sub_pd(s2x, s1x);
+    __m128d dy = _mm_sub_pd(s2y, s1y);
+
+    __m128d q1x = _mm_set1_pd(q.x1), q1y = _mm_set1_pd(q.y1);
+    __m128d q2x = _mm_set1_pd(q.x2), q2y = _mm_set1_pd(q.y2);
+    __m128d qdx = _mm_set1_pd(q.dx), qdy = _mm_set1_pd(q.dy);
+
+    __m128d g1 = _mm_sub_pd(_mm_mul_pd(dx, _mm_sub_pd(q1y, s1y)), _mm_mul_pd(dy, _mm_sub_pd(q1x, s1x)));
+    __m128d h1 = _mm_sub_pd(_mm_mul_pd(dx, _mm_sub_pd(q2y, s1y)), _mm_mul_pd(dy, _mm_sub_pd(q2x, s1x)));
+    __m128d g2 = _mm_sub_pd(_mm_mul_pd(qdx, _mm_sub_pd(s1y, q1y)), _mm_mul_pd(qdy, _mm_sub_pd(s1x, q1x)));
+    __m128d h2 = _mm_sub_pd(_mm_mul_pd(qdx, _mm_sub_pd(s2y, q1y)), _mm_mul_pd(qdy, _mm_sub_pd(s2x, q1x)));
+
+    __m128d abs_mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFF));
+    __m128d bound = _mm_set1_pd(q.bound);
+    __m128d smallest = _mm_min_pd(_mm_min_pd(_mm_and_pd(g1, abs_mask), _mm_and_pd(h1, abs_mask)),
+                                  _mm_min_pd(_mm_and_pd(g2, abs_mask), _mm_and_pd(h2, abs_mask)));
+    __m128d uncertain = _mm_cmple_pd(smallest, bound);
+
+    __m128d hit = _mm_and_pd(_mm_xor_pd(g1, h1), _mm_xor_pd(g2, h2));
+
+    hit = _mm_and_pd(hit, _mm_cmpge_pd(_mm_set1_pd(q.max_x), _mm_min_pd(s1x, s2x)));
+    hit = _mm_and_pd(hit, _mm_cmple_pd(_mm_set1_pd(q.min_x), _mm_max_pd(s1x, s2x)));
+    hit = _mm_and_pd(hit, _mm_cmpge_pd(_mm_set1_pd(q.max_y), _mm_min_pd(s1y, s2y)));
+    hit = _mm_and_pd(hit, _mm_cmple_pd(_mm_set1_pd(q.min_y), _mm_max_pd(s1y, s2y)));
+
+    auto hits = static_cast<std::uint64_t>(_mm_movemask_pd(hit));
+    auto uncertain_lanes = static_cast<std::uint64_t>(_mm_movemask_pd(uncertain));
+    return uncertain_lanes == 0 ? hits : resolve(q, segs, i, hits, uncertain_lanes);
+}
+
+#else
+
+constexpr std::size_t lanes = 1;
+
+std::uint64_t intersect_simd(const Query &q, const SegmentBlock &segs, std::size_t i)
+{
+    return intersect_scalar(q, segs, i, 1);
+}
 
-    if (argc > 1) verbose = true;
+#endif
 
-    std::cout << std::boolalpha << on_opposite_sides({0, 0}, {2, 2}, {{2,1}, {4, 2}});
+} // end anonymous namespace
 
-    Line l1 = ask_line();
-    Line l2 = ask_line();
+void intersect_batch(Line l, const SegmentBlock &segs, std::uint64_t *mask)
+{
+    Query q{l, segs.max_abs};
+
+    for (std::size_t w = 0, len = segs.size(); w * 64 < len; ++w)
+    {
+        std::size_t begin = w * 64;
+        std::size_t count = std::min<std::size_t>(64, len - begin);
+        std::size_t vectorised = count - count % lanes;
+
+        std::uint64_t bits = 0;
+        for (std::size_t k = 0; k < vectorised; k += lanes)
+        {
+            bits |= intersect_simd(q, segs, begin + k) << k;
+        }
+        INSTRUMENT_COUNT(predicate_calls, 4 * vectorised);
+        if (vectorised < count) {
+            bits |= intersect_scalar(q, segs, begin + vectorised, count - vectorised) << vectorised;
+        }
 
-    std::cout << "the two lines" << (intersect(l1, l2, verbose) ? " "sv : " don't "sv) << "intersect.\n";
+        mask[w] = bits;
+    }
 }
 
+std::vector<std::uint64_t> intersect_batch(Line q, const SegmentBlock &segs)
+{
+    std::vector<std::uint64_t> mask(mask_words(segs.size()));
+    intersect_batch(q, segs, mask.data());
+    return mask;
+}
 
+// the on_opposite_sides tests on their own are
+// sufficient to determine whether two line segments intersect,
+// except in one special case – can you find it?
 
+// The special case would be when the two segments are part of the same line.
+// In such case both points would satisfy the line equation for either line segment provided.
@@ -0,0 +1,122 @@
+//
+// Created by bruno on 14/10/17.
+//
+
+#ifndef UNTITLED_LECTURE1_H
+#define UNTITLED_LECTURE1_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include "common.h"
+#include "predicates.h"
+
+// Problem 1: determining if two line segments intersect.
+
+bool on_opposite_sides(Point a, Point b, Line l);
+
+/**
+ * Smallest rectangle with sides parallel to the axes containing a line segment.
+ */
+struct BoundingBox
+{
+    double min_x;
+    double max_x;
+    double min_y;
+    double max_y;
+
+    BoundingBox() = default;
+
+    explicit BoundingBox(Line l)
+    {
+        std::tie(min_x, max_x) = std::minmax(l.p1.x, l.p2.x);
+        std::tie(min_y, max_y) = std::minmax(l.p1.y, l.p2.y);
+    }
+};
+
+/**
+ * Whether the boxes overlap (or touch). Boxes kept from one test to the next aren't computed again.
+ */
+inline bool bounding_box_collision(const BoundingBox &bb1, const BoundingBox &bb2)
+{
+    return bb1.max_x >= bb2.min_x &&
+           bb1.min_x <= bb2.max_x &&
+           bb1.max_y >= bb2.min_y &&
+           bb1.min_y <= bb2.max_y;
+}
+
+bool bounding_box_collision(Line l1, Line l2);
+
+bool intersect(Line l1, Line l2);
+
+bool intersect(Line l1, Line l2, bool verbose);
+
+// The same tests for the other coordinate types (see predicates::Kernel).
+
+template <class T>
+bool on_opposite_sides(BasicPoint<T> a, BasicPoint<T> b, BasicLine<T> l)
+{
+    auto g = predicates::orient2d(l.p1, l.p2, a);
+    auto h = predicates::orient2d(l.p1, l.p2, b);
+
+    return !(g > 0 && h > 0) && !(g < 0 && h < 0);
+}
+
+template <class T>
+bool bounding_box_collision(BasicLine<T> l1, BasicLine<T> l2)
+{
+    return std::max(l1.p1.x, l1.p2.x) >= std::min(l2.p1.x, l2.p2.x) &&
+           std::min(l1.p1.x, l1.p2.x) <= std::max(l2.p1.x, l2.p2.x) &&
+           std::max(l1.p1.y, l1.p2.y) >= std::min(l2.p1.y, l2.p2.y) &&
+           std::min(l1.p1.y, l1.p2.y) <= std::max(l2.p1.y, l2.p2.y);
+}
+
+template <class T>
+bool intersect(BasicLine<T> l1, BasicLine<T> l2)
+{
+    return on_opposite_sides(l1.p1, l1.p2, l2) &&
+           on_opposite_sides(l2.p1, l2.p2, l1) &&
+           bounding_box_collision(l1, l2);
+}
+
+/**
+ * Line segments stored as a structure of arrays, so that many of them can be tested at once.
+ */
+struct SegmentBlock
+{
+    std::vector<double> x1;
+    std::vector<double> y1;
+    std::vector<double> x2;
+    std::vector<double> y2;
+    double max_abs = 0; // Largest absolute value of a coordinate, for the error bound of intersect_batch.
+
+    void push_back(Line l)
+    {
+        x1.push_back(l.p1.x);
+        y1.push_back(l.p1.y);
+        x2.push_back(l.p2.x);
+        y2.push_back(l.p2.y);
+        max_abs = std::max({max_abs, std::abs(l.p1.x), std::abs(l.p1.y), std::abs(l.p2.x), std::abs(l.p2.y)});
+    }
+
+    std::size_t size() const { return x1.size(); }
+};
+
+/**
+ * Words needed for the result mask of intersect_batch over n segments.
+ */
+constexpr std::size_t mask_words(std::size_t n) { return (n + 63) / 64; }
+
+/**
+ * Same as intersect(q, l) for each segment l of segs: bit i of the mask
+ * (mask[i / 64] >> (i % 64)) is set if q intersects the i-th segment.
+ * mask must hold mask_words(segs.size()) words.
+ */
+void intersect_batch(Line q, const SegmentBlock &segs, std::uint64_t *mask);
+
+std::vector<std::uint64_t> intersect_batch(Line q, const SegmentBlock &segs);
+
+#endif //UNTITLED_LECTURE1_H
@@ -0,0 +1,49 @@
+//
+// Created by bruno on 14/10/17.
+//
+
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "common.h"
+#include "lecture1.h"
+#include "lecture4.h"
+
+using namespace std::string_view_literals;
+
+// Testing (problem 1), and the line sweeps of problem 5.
+
+int main(int argc, char* argv[])
+{
+    int verbose = false;
+
+    if (argc > 1) verbose = true;
+
+    std::string choice;
+    std::cout << "Problem to run? 'li' for line segment intersection (problem 1), "
+                 "'hv' for horizontal/vertical segment intersections (problem 5), "
+                 "'all' for all segment intersections (problem 5, general case): ";
+    std::getline(std::cin, choice);
+
+    if (choice == "hv" || choice == "all") {
+        std::cout << problem5::description << std::endl;
+        if (choice == "hv") {
+            problem5::run(verbose);
+        } else {
+            problem5::run_general(verbose);
+        }
+        std::cout << problem5::analysis << std::endl;
+        return 0;
+    }
+
+    std::cout << std::boolalpha << on_opposite_sides({0, 0}, {2, 2}, {{2,1}, {4, 2}});
+
+    Line l1 = ask_line();
+    Line l2 = ask_line();
+
+    std::cout << "the two lines" << (intersect(l1, l2, verbose) ? " "sv : " don't "sv) << "intersect.\n";
+}
+
+
+
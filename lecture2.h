@@ -0,0 +1,1349 @@
+//
+// Created by bruno on 14/10/17.
+//
+
+#ifndef UNTITLED_LECTURE2_H
+#define UNTITLED_LECTURE2_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <set>
+#include <type_traits>
+#include <vector>
+
+#include "common.h"
+#include "instrument.h"
+#include "lecture1.h"
+#include "parallel.h"
+#include "predicates.h"
+
+static constexpr double pi = 3.1415926535897;
+
+namespace problem2 {
+
+/**
+ * Return magnitude of vector
+ */
+inline double vec_abs(Vec2d vec)
+{
+    return std::hypot(vec.x, vec.y);
+}
+
+/**
+ * Sorts pts on keys (keys[i] belongs to pts[i]); points with the same key are ordered by tie_less.
+ * The keys are kept out of the points: (key, index) pairs are sorted, then the points are moved
+ * to their place in one pass. keys ends up in the new order of the points.
+ */
+template <class It, class TieLess>
+void sort_on_keys(range<It> pts, std::vector<double> &keys, TieLess tie_less)
+{
+    struct KeyedIndex
+    {
+        double key;
+        std::size_t index;
+    };
+
+    INSTRUMENT_PHASE(sort);
+    It first = pts.begin();
+    std::vector<KeyedIndex> order(pts.size());
+    INSTRUMENT_ALLOC(order.size() * sizeof(KeyedIndex));
+    for (std::size_t i = 0, len = order.size(); i < len; ++i)
+    {
+        order[i] = {keys[i], i};
+    }
+
+    std::sort(order.begin(), order.end(), [first, &tie_less](const KeyedIndex &k1, const KeyedIndex &k2)
+    {
+        INSTRUMENT_COUNT(comparisons, 1);
+        return k1.key < k2.key || (k1.key == k2.key && tie_less(first[k1.index], first[k2.index]));
+    });
+
+    PointSet sorted(order.size());
+    INSTRUMENT_ALLOC(sorted.size() * sizeof(Point));
+    for (std::size_t i = 0, len = order.size(); i < len; ++i)
+    {
+        sorted[i] = first[order[i].index];
+        keys[i] = order[i].key;
+    }
+    std::copy(sorted.begin(), sorted.end(), first);
+}
+
+template <class It>
+void simple_polygon_v1(range<It> pts)
+{
+    // Make pts[0] be the point with the greatest x-coord (or with the smallest y-coord if x-coord are the same).
+    std::nth_element(pts.begin(), pts.begin(), pts.end(), [](const Point &p1, const Point &p2)
+    {
+        return p1.x > p2.x || (p1.x == p2.x && p1.y < p2.y);
+    });
+
+    Point p0 = pts.first();
+    auto [pivot, others] = pts.split_at(1);
+
+    std::vector<double> angles(others.size());
+    INSTRUMENT_ALLOC(angles.size() * sizeof(double));
+    std::size_t i = 0;
+    for (Point p : others)
+    {
+        double num = p0.x - p.x;
+        double denom = p.y - p0.y;
+        // Order the points by the angle between the pivot and p.
+        angles[i++] = std::atan2(num, denom);
+    }
+
+    // Order by the angle. If tie, use the one with smaller distance from the pivot point (p0).
+    sort_on_keys(others, angles, [p0](const Point &p1, const Point &p2)
+    {
+        return vec_abs(p0 - p1) < vec_abs(p0 - p2);
+    });
+}
+
+inline void simple_polygon_v1(PointSet &ps)
+{
+    simple_polygon_v1(range(ps.begin(), ps.end()));
+}
+
+
+// Two aspects can be simplified:
+// - no need to use the arctan function. Can simply sort according to gradients.
+// - no need to compute the square root to sort on distances (std::hypot does it). Can simply sort on squares.
+
+/**
+ * Same as vec_abs, but does not sqrt the result.
+ */
+inline double squared_vec_abs(Vec2d vec)
+{
+    return std::pow(vec.x, 2) + std::pow(vec.y, 2);
+};
+
+/**
+ * Returns the gradients of pts[1...], in the new order of the points.
+ */
+template <class It>
+std::vector<double> simple_polygon_v2(range<It> pts)
+{
+    // Make pts[0] be the point with the greatest x-coord (or with the smallest y-coord if x-coord are the same).
+    std::nth_element(pts.begin(), pts.begin(), pts.end(), [](const Point &p1, const Point &p2)
+    {
+        return p1.x > p2.x || (p1.x == p2.x && p1.y < p2.y);
+    });
+
+    Point p0 = pts.first();
+    auto [pivot, others] = pts.split_at(1);
+
+    std::vector<double> gradients(others.size());
+    INSTRUMENT_ALLOC(gradients.size() * sizeof(double));
+    std::size_t i = 0;
+    for (Point p : others)
+    {
+        double denom = p0.x - p.x;
+        double num   = p0.y - p.y;
+
+        // Note: no atan. Simple gradient (Dy/Dx).
+        gradients[i++] = num / denom;
+    }
+
+    // Order by the angle. If tie, use the one with smaller distance from the pivot point (p0).
+    sort_on_keys(others, gradients, [p0](const Point &p1, const Point &p2)
+    {
+        return squared_vec_abs(p0 - p1) < squared_vec_abs(p0 - p2);
+    });
+
+    return gradients;
+}
+
+inline void simple_polygon_v2(PointSet &ps)
+{
+    simple_polygon_v2(range(ps.begin(), ps.end()));
+}
+
+// One last problem to address (tutorial 1 exercise 6):
+// If the last two (or more) points are coplanar with the pivot (ps[0]),
+// then sort them by decreasing distance to the pivot.
+
+template <class It>
+void simple_polygon_v3(range<It> pts)
+{
+    // The first steps are equivalent to the previous version.
+    std::vector<double> gradients = simple_polygon_v2(pts);
+
+    // Find the first element where the gradient is different from the previous, starting from the end.
+    auto mismatch = std::adjacent_find(gradients.rbegin(), gradients.rend(), std::not_equal_to<>()).base();
+
+    if (std::distance(mismatch, gradients.end()) > 0)
+    {
+        // If there are more than one consecutive element with the same gradient, reverse the order until the end.
+        // (gradients[i] belongs to pts[i + 1])
+        std::reverse(pts.begin() + std::max<std::ptrdiff_t>(mismatch - gradients.begin(), 1), pts.end());
+    }
+}
+
+inline void simple_polygon_v3(PointSet &ps)
+{
+    simple_polygon_v3(range(ps.begin(), ps.end()));
+}
+
+// Sorting without comparisons (for big point sets):
+// - The order of the gradients is the order of dy / (|dx| + |dy|) (a pseudo-angle), which can be computed
+//   for every point: |dx| + |dy| is never 0 (but for copies of the pivot).
+// - The bits of a double, flipped as needed, are an integer in the same order: the points are sorted
+//   on those with a radix sort, in O(n), in parallel.
+// - Points at the same angle are then put in order of distance, then the last ones reversed, as in v3.
+
+/**
+ * Integer key in the reverse order of the double v.
+ */
+inline std::uint64_t descending_key(double v)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &v, sizeof bits);
+    bits = bits >> 63 ? ~bits : bits | (std::uint64_t(1) << 63);
+    return ~bits;
+}
+
+/**
+ * Same order as simple_polygon_v3. Copies of the pivot come right after it.
+ */
+template <class It>
+void simple_polygon_v4(range<It> pts, unsigned threads = hardware_threads())
+{
+    INSTRUMENT_PHASE(sort);
+
+    // Make pts[0] be the point with the greatest x-coord (or with the smallest y-coord if x-coord are the same).
+    std::nth_element(pts.begin(), pts.begin(), pts.end(), [](const Point &p1, const Point &p2)
+    {
+        return p1.x > p2.x || (p1.x == p2.x && p1.y < p2.y);
+    });
+
+    Point p0 = pts.first();
+    auto [pivot, others] = pts.split_at(1);
+
+    struct KeyedPoint
+    {
+        std::uint64_t key;
+        Point p;
+    };
+
+    std::vector<KeyedPoint> keyed(others.size());
+    INSTRUMENT_ALLOC(keyed.size() * sizeof(KeyedPoint));
+    std::size_t i = 0;
+    for (Point p : others)
+    {
+        // p is on the left of the pivot, or straight above it: dx <= 0.
+        double dx = p.x - p0.x;
+        double dy = p.y - p0.y;
+        double sum = std::abs(dy) - dx;
+        keyed[i++] = {descending_key(sum > 0 ? dy / sum : 1.0), p};
+    }
+
+    radix_sort(keyed, [](const KeyedPoint &kp) { return kp.key; }, threads);
+
+    // Order by distance from the pivot within each angle, and find the start of the last angle.
+    auto distance = [p0](const KeyedPoint &kp) { return squared_vec_abs(kp.p - p0); };
+    std::size_t last_run = 0;
+    for (std::size_t first = 0, len = keyed.size(); first < len;)
+    {
+        std::size_t end = first + 1;
+        while (end < len && keyed[end].key == keyed[first].key) ++end;
+        if (end - first > 1) {
+            std::sort(keyed.begin() + first, keyed.begin() + end, [&](const KeyedPoint &a, const KeyedPoint &b) {
+                INSTRUMENT_COUNT(comparisons, 1);
+                return distance(a) < distance(b);
+            });
+        }
+        last_run = first;
+        first = end;
+    }
+
+    // If the last points are on the same line through the pivot, reverse their order.
+    std::reverse(keyed.begin() + last_run, keyed.end());
+
+    std::transform(keyed.begin(), keyed.end(), others.begin(), [](const KeyedPoint &kp) { return kp.p; });
+}
+
+inline void simple_polygon_v4(PointSet &ps)
+{
+    simple_polygon_v4(range(ps.begin(), ps.end()));
+}
+
+// For coordinates other than double (see predicates::Kernel) a gradient, or any other angle, would be rounded.
+// The angles are compared instead: b comes after a if it turns left of pivot->a, an orientation test
+// which the kernel computes exactly. All the points are on one side of the pivot, so this is an order.
+
+/**
+ * Same order as simple_polygon_v3, for any coordinate type, with exact comparisons.
+ */
+template <class It>
+void simple_polygon_exact(range<It> pts)
+{
+    using P = typename std::iterator_traits<It>::value_type;
+
+    // Make pts[0] be the point with the greatest x-coord (or with the smallest y-coord if x-coord are the same).
+    std::nth_element(pts.begin(), pts.begin(), pts.end(), [](const P &p1, const P &p2)
+    {
+        return p1.x > p2.x || (p1.x == p2.x && p1.y < p2.y);
+    });
+
+    P p0 = pts.first();
+    auto [pivot, others] = pts.split_at(1);
+
+    {
+        INSTRUMENT_PHASE(sort);
+        // Order by the angle. If tie, use the one with smaller distance from the pivot point (p0).
+        // Copies of the pivot are at distance 0: they come first.
+        std::sort(others.begin(), others.end(), [p0](const P &p1, const P &p2)
+        {
+            INSTRUMENT_COUNT(comparisons, 1);
+            auto turn = predicates::orient2d(p0, p1, p2);
+            return turn > 0 ||
+                   (turn == 0 && predicates::squared_distance(p0, p1) < predicates::squared_distance(p0, p2));
+        });
+    }
+
+    // If the last points are on the same line through the pivot, reverse their order.
+    if (others.size() > 1) {
+        It first = others.begin();
+        std::size_t last_run = others.size() - 1;
+        auto is_pivot = [p0](P p) { return p.x == p0.x && p.y == p0.y; };
+        while (last_run > 0 && !is_pivot(first[last_run - 1]) &&
+               predicates::orient2d(p0, first[last_run - 1], first[last_run]) == 0) {
+            --last_run;
+        }
+        std::reverse(first + last_run, others.end());
+    }
+}
+
+} // end namespace problem2
+
+namespace problem3
+{
+
+template <class T>
+bool angle_gteq_pi(BasicLine<T> a, BasicLine<T> b)
+{
+    // Use the cross product between two vectors.
+    // Given that u x v = |u| * |v| * sin(angle) * n
+    // and that sin(angle) <= 0 if pi <= angle <= 2pi,
+    // we can say that u x v should be negative.
+    // The cross product then only boils down to:
+    // (da.x * db.y - da.y * db.x) with da = a.p2 - a.p1 and db = b.p2 - b.p1,
+    // with its sign computed exactly: near-collinear points must not be kept or dropped by a rounding error.
+    return predicates::cross2d(a.p1, a.p2, b.p1, b.p2) <= 0;
+
+}
+template <class It>
+auto graham_scan(range<It> pts, bool verbose)
+{
+    using P = typename std::iterator_traits<It>::value_type;
+    using L = BasicLine<typename P::coordinate_type>;
+
+    std::vector<P> ch{pts.size(), P{}}; // Points belonging to the convex hull.
+    INSTRUMENT_ALLOC(ch.size() * sizeof(P));
+    // Doubles keep the radix sort on their (rounded) angles, the fastest.
+    if constexpr (std::is_same_v<P, Point>) {
+        problem2::simple_polygon_v4(pts);
+    } else {
+        problem2::simple_polygon_exact(pts);
+    }
+
+    if (verbose) std::cout << "Simple polygon    : "<< pts << std::endl;
+
+    It ps = pts.begin();
+    INSTRUMENT_PHASE(scan);
+
+    // Given the way simple_polygon works, the first 3 points always form a right turn.
+    ch[0] = ps[0];
+    ch[1] = ps[1];
+    ch[2] = ps[2];
+
+    std::size_t m = 2; // m points other than the pivot in current hull
+    for (std::size_t k = 3, len = pts.size(); k < len; ++k)
+    {
+        while (angle_gteq_pi(L{ch[m-1], ch[m]}, L{ch[m], ps[k]}))
+        {
+            --m; // exclude ch[m]
+            INSTRUMENT_COUNT(stack_pops, 1);
+        }
+        ch[++m] = ps[k];
+        if (verbose) std::cout << "iteration: " << ch << std::endl;
+    }
+
+    ch.resize(m + 1);
+    return ch;
+}
+
+template <class T>
+std::vector<BasicPoint<T>> graham_scan(std::vector<BasicPoint<T>> &ps, bool verbose)
+{
+    return graham_scan(range(ps.begin(), ps.end()), verbose);
+}
+
+/**
+ * Same as graham_scan, reading the points in place (eg. from a mapped point file).
+ * Only the working copy which simple_polygon_v3 reorders is made.
+ */
+inline PointSet graham_scan(const PointView &pv, bool verbose)
+{
+    PointSet ps(pv.begin(), pv.end());
+    return graham_scan(ps, verbose);
+}
+
+// Multi-core convex hull:
+// - Akl-Toussaint heuristic: the extreme points in 8 directions (min/max of x, y, x+y, x-y) are on the hull.
+//   Any point strictly inside the octagon they form can't be, and is discarded. For scattered inputs
+//   that is almost all of them. Both the search and the filter are independent passes over chunks.
+// - Each chunk of the remaining points gets its own hull (monotone chain), and the hull of the union of
+//   those partial hulls is the hull of all the points.
+
+/**
+ * Scan of Andrew's monotone chain over first...last, sorted on x-coord then y-coord, without copies.
+ * Same contract as monotone_chain, in O(n).
+ */
+template <class It, class P>
+std::size_t monotone_chain_sorted(It first, It last, P *out)
+{
+    using L = BasicLine<typename P::coordinate_type>;
+
+    std::size_t n = last - first;
+    if (n < 3) {
+        std::copy(first, last, out);
+        return n;
+    }
+
+    INSTRUMENT_PHASE(scan);
+    P *ch = out;
+    std::size_t m = 0;
+
+    // Lower hull, left to right.
+    for (It it = first; it != last; ++it)
+    {
+        while (m >= 2 && angle_gteq_pi(L{ch[m - 2], ch[m - 1]}, L{ch[m - 1], *it}))
+        {
+            --m;
+            INSTRUMENT_COUNT(stack_pops, 1);
+        }
+        ch[m++] = *it;
+    }
+
+    // Upper hull, right to left.
+    for (std::size_t k = n - 1, lower = m + 1; k-- > 0;)
+    {
+        P p = first[k];
+        while (m >= lower && angle_gteq_pi(L{ch[m - 2], ch[m - 1]}, L{ch[m - 1], p}))
+        {
+            --m;
+            INSTRUMENT_COUNT(stack_pops, 1);
+        }
+        ch[m++] = p;
+    }
+
+    return m - 1; // The first point is also the last one.
+}
+
+/**
+ * Andrew's monotone chain. Writes the hull of pts (which get sorted) to out, counter-clockwise from
+ * the lowest of the leftmost points, without collinear points (same turn test as graham_scan).
+ * out must have room for 2 * pts.size() points. Returns the number of points on the hull.
+ */
+template <class It, class P>
+std::size_t monotone_chain(range<It> pts, P *out)
+{
+    It last;
+    {
+        INSTRUMENT_PHASE(sort);
+        std::sort(pts.begin(), pts.end(), [](P a, P b) {
+            INSTRUMENT_COUNT(comparisons, 1);
+            return a.x < b.x || (a.x == b.x && a.y < b.y);
+        });
+        last = std::unique(pts.begin(), pts.end(), [](P a, P b) { return a.x == b.x && a.y == b.y; });
+    }
+    return monotone_chain_sorted(pts.begin(), last, out);
+}
+
+template <class T>
+std::vector<BasicPoint<T>> monotone_chain(std::vector<BasicPoint<T>> pts)
+{
+    std::vector<BasicPoint<T>> ch(2 * pts.size());
+    INSTRUMENT_ALLOC(ch.size() * sizeof(ch[0]));
+    ch.resize(monotone_chain(range(pts.begin(), pts.end()), ch.data()));
+    return ch;
+}
+
+/**
+ * Rotates a counter-clockwise hull so that it starts at graham_scan's pivot
+ * (greatest x-coord, smallest y-coord if tie).
+ */
+inline void start_at_pivot(PointSet &hull)
+{
+    auto pivot = std::min_element(hull.begin(), hull.end(), [](Point p1, Point p2) {
+        return p1.x > p2.x || (p1.x == p2.x && p1.y < p2.y);
+    });
+    std::rotate(hull.begin(), pivot, hull.end());
+}
+
+/**
+ * Discards the points of pts strictly inside the octagon of its extreme points.
+ * Survivors are returned per chunk of pts, each chunk being handled by one task.
+ */
+inline std::vector<PointSet> akl_toussaint_filter(const PointSet &pts, std::size_t chunks, unsigned threads)
+{
+    // Directions counter-clockwise from +x: the extreme points follow the hull in the same order.
+    static constexpr double dirs[8][2] = {{1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}};
+
+    auto chunk_range = [&](std::size_t c) {
+        return range(pts.begin() + c * pts.size() / chunks, pts.begin() + (c + 1) * pts.size() / chunks);
+    };
+
+    std::vector<std::array<Point, 8>> chunk_extremes(chunks);
+    parallel_for(chunks, [&](std::size_t c) {
+        std::array<double, 8> best;
+        best.fill(-std::numeric_limits<double>::infinity());
+        for (Point p : chunk_range(c))
+        {
+            for (std::size_t d = 0; d < 8; ++d)
+            {
+                double v = dirs[d][0] * p.x + dirs[d][1] * p.y;
+                if (v > best[d]) {
+                    best[d] = v;
+                    chunk_extremes[c][d] = p;
+                }
+            }
+        }
+    }, threads);
+
+    PointSet octagon;
+    for (std::size_t d = 0; d < 8; ++d)
+    {
+        Point best = chunk_extremes[0][d];
+        for (std::size_t c = 1; c < chunks; ++c)
+        {
+            Point p = chunk_extremes[c][d];
+            if (dirs[d][0] * p.x + dirs[d][1] * p.y > dirs[d][0] * best.x + dirs[d][1] * best.y) best = p;
+        }
+        if (octagon.empty() || best.x != octagon.back().x || best.y != octagon.back().y) octagon.push_back(best);
+    }
+    if (octagon.size() > 1 && octagon.front().x == octagon.back().x && octagon.front().y == octagon.back().y) {
+        octagon.pop_back();
+    }
+
+    std::vector<PointSet> survivors(chunks);
+    parallel_for(chunks, [&](std::size_t c) {
+        INSTRUMENT_PHASE(filter);
+        for (Point p : chunk_range(c))
+        {
+            // A degenerate octagon (all points collinear) has no inside.
+            bool inside = octagon.size() >= 3;
+            for (std::size_t i = 0, len = octagon.size(); inside && i < len; ++i)
+            {
+                // Strictly inside means a left turn at every edge.
+                inside = !angle_gteq_pi(Line{octagon[i], octagon[(i + 1) % len]}, Line{octagon[(i + 1) % len], p});
+            }
+            if (!inside) survivors[c].push_back(p);
+        }
+    }, threads);
+
+    return survivors;
+}
+
+/**
+ * Same result as graham_scan for points in general position: the vertices of the hull counter-clockwise,
+ * starting from the same pivot (greatest x-coord, smallest y-coord if tie). Leaves pts untouched.
+ */
+inline PointSet parallel_hull(const PointSet &pts, unsigned threads = hardware_threads())
+{
+    if (pts.empty()) return {};
+
+    // A few chunks per thread, to even out the load.
+    std::size_t chunks = std::max<std::size_t>(1, std::min<std::size_t>(4 * threads, pts.size() / 4096));
+
+    std::vector<PointSet> partial = akl_toussaint_filter(pts, chunks, threads);
+    parallel_for(chunks, [&](std::size_t c) {
+        partial[c] = monotone_chain(std::move(partial[c]));
+    }, threads);
+
+    PointSet candidates;
+    for (const PointSet &ch : partial)
+    {
+        candidates.insert(candidates.end(), ch.begin(), ch.end());
+    }
+    PointSet hull = monotone_chain(std::move(candidates));
+    start_at_pivot(hull);
+    return hull;
+}
+
+// Output-sensitive convex hull (Chan's algorithm): O(n log h), for h points on the hull.
+// - Guess the hull size m, split the points into groups of m and find the hull of each group: O(n log m).
+// - Jarvis march (gift wrapping) from the pivot: the next hull vertex is the most clockwise point as seen
+//   from the current one. Only the tangent points of the group hulls can be. As the march goes round,
+//   the tangent point of each group moves forward around the group's hull, so following them costs
+//   O(n) overall, on top of O(n / m) per step.
+// - If the march isn't back at the pivot after m steps, h > m: square the guess and try again.
+//   The guesses grow so fast that the last one dominates the cost: O(n log h).
+
+/**
+ * Whether a comes before b when wrapping counter-clockwise around p: a is right of p->b,
+ * or further than b on the same line.
+ */
+inline bool wraps_before(Point p, Point a, Point b)
+{
+    auto same = [](Point p1, Point p2) { return p1.x == p2.x && p1.y == p2.y; };
+    if (same(a, p)) return false;
+    if (same(b, p)) return true;
+
+    double turn = predicates::orient2d(p, b, a);
+    return turn < 0 || (turn == 0 && problem2::squared_vec_abs(a - p) > problem2::squared_vec_abs(b - p));
+}
+
+/**
+ * One round of Chan's algorithm with groups of m points. Returns false if the hull has more than m points.
+ */
+inline bool chan_round(const PointSet &ps, std::size_t m, PointSet &hull)
+{
+    // All the groups are sorted in one working copy, and their hulls share one buffer.
+    std::size_t groups = (ps.size() + m - 1) / m;
+    PointSet work = ps;
+    PointSet hull_points(2 * ps.size());
+    INSTRUMENT_ALLOC((work.size() + hull_points.size()) * sizeof(Point));
+    std::vector<range<Point *>> group_hulls;
+    group_hulls.reserve(groups);
+    for (std::size_t g = 0; g < groups; ++g)
+    {
+        auto [group, rest] = range(work.data() + g * m, work.data() + work.size()).split_at(std::min(m, ps.size() - g * m));
+        Point *out = hull_points.data() + 2 * g * m;
+        group_hulls.emplace_back(out, out + monotone_chain(group, out));
+    }
+
+    Point p0 = *std::min_element(ps.begin(), ps.end(), [](Point p1, Point p2) {
+        return p1.x > p2.x || (p1.x == p2.x && p1.y < p2.y);
+    });
+
+    // Tangent point of each group seen from the pivot, by linear scan. Afterwards they only move forward.
+    std::vector<std::size_t> tangent(groups, 0);
+    for (std::size_t g = 0; g < groups; ++g)
+    {
+        Point *gh = group_hulls[g].begin();
+        for (std::size_t i = 1; i < group_hulls[g].size(); ++i)
+        {
+            if (wraps_before(p0, gh[i], gh[tangent[g]])) tangent[g] = i;
+        }
+    }
+
+    hull.assign(1, p0);
+    for (Point p = p0; hull.size() <= m;)
+    {
+        Point next = p;
+        for (std::size_t g = 0; g < groups; ++g)
+        {
+            Point *gh = group_hulls[g].begin();
+            std::size_t size = group_hulls[g].size();
+            std::size_t &t = tangent[g];
+            for (std::size_t steps = 0; steps < size && wraps_before(p, gh[(t + 1) % size], gh[t]); ++steps)
+            {
+                t = (t + 1) % size;
+            }
+            if (wraps_before(p, gh[t], next)) next = gh[t];
+        }
+
+        if ((next.x == p0.x && next.y == p0.y) || (next.x == p.x && next.y == p.y)) {
+            return true; // Back to the pivot.
+        }
+        hull.push_back(next);
+        p = next;
+    }
+    return false;
+}
+
+/**
+ * Number of points on the hull of an evenly spaced sample of about 1000 points of ps.
+ */
+inline std::size_t sample_hull_size(const PointSet &ps)
+{
+    std::size_t stride = std::max<std::size_t>(1, ps.size() / 1024);
+    PointSet sample;
+    for (std::size_t i = 0; i < ps.size(); i += stride) sample.push_back(ps[i]);
+
+    return monotone_chain(sample).size();
+}
+
+/**
+ * Same contract as parallel_hull: the hull counter-clockwise from graham_scan's pivot. Leaves ps untouched.
+ * The first guess of the hull size comes from the hull of a sample: the whole hull has more points,
+ * but a guess close to h saves the early rounds, which would fail anyway.
+ */
+inline PointSet chan_hull(const PointSet &ps)
+{
+    PointSet hull;
+    for (std::size_t m = std::max<std::size_t>(16, 4 * sample_hull_size(ps)); ; m = m * m)
+    {
+        if (m >= ps.size()) {
+            // A single group: its hull is the answer.
+            hull = monotone_chain(ps);
+            start_at_pivot(hull);
+            return hull;
+        }
+        if (chan_round(ps, m, hull)) return hull;
+    }
+}
+
+enum class HullMethod
+{
+    graham,
+    chan,
+    automatic // Chan's algorithm if the hull looks small compared to the number of points.
+};
+
+/**
+ * Convex hull with the chosen method. As graham_scan, ps may be reordered.
+ * The automatic choice looks at the hull of a sample of the points (see sample_hull_size):
+ * if most of them are inside it, the full hull is expected to be small.
+ */
+inline PointSet convex_hull(PointSet &ps, HullMethod method = HullMethod::automatic)
+{
+    if (method == HullMethod::automatic) {
+        std::size_t sample_size = std::min<std::size_t>(ps.size(), 1024);
+        method = sample_hull_size(ps) * 16 < sample_size ? HullMethod::chan : HullMethod::graham;
+    }
+
+    return method == HullMethod::chan ? chan_hull(ps) : graham_scan(ps, false);
+}
+
+// Incremental convex hull, for points arriving over time.
+// The hull is kept as its upper and lower chains, each ordered on x in a balanced tree. A new point is
+// dropped if the chains cover it; otherwise it goes in, and its neighbours which no longer turn the right
+// way are removed. A point is removed at most once, so an insertion is O(log h) amortized, and only the
+// hull is stored. The lower chain is kept as the upper chain of the points mirrored on the x axis.
+// Each vertex also holds the slope of the edge to the next one. Those decrease along the chain, which lets
+// the tree be searched on edges: extreme point in a direction, tangents from a point, in O(log h).
+
+/**
+ * Upper hull: x-monotone chain, turning right from left to right. One vertex per x-coord.
+ */
+class HullChain
+{
+public:
+    struct Vertex
+    {
+        double x;
+        double y;
+        mutable double slope; // Of the edge to the next vertex; -inf for the last one (a ray down).
+
+        operator Point() const { return Point{x, y}; }
+    };
+
+    // The chain is searched with these as well as with x-coords.
+    struct Direction { Vec2d d; };  // Needs d.y > 0.
+    struct FirstVisible { Point q; };
+    struct LastVisible { Point q; };
+
+    struct Order
+    {
+        using is_transparent = void;
+
+        bool operator()(const Vertex &a, const Vertex &b) const { return a.x < b.x; }
+        bool operator()(const Vertex &v, double x) const { return v.x < x; }
+
+        // Going along the edge increases the dot product with d.
+        bool operator()(const Vertex &v, Direction dir) const { return dir.d.x + dir.d.y * v.slope > 0; }
+
+        // The edges q is strictly above form a range around q.x: the tangents are at its ends.
+        bool operator()(const Vertex &v, FirstVisible vis) const { return v.x <= vis.q.x && !visible(v, vis.q); }
+        bool operator()(const Vertex &v, LastVisible vis) const { return v.x <= vis.q.x || visible(v, vis.q); }
+    };
+
+    using Vertices = std::set<Vertex, Order>;
+
+    static bool visible(const Vertex &v, Point q)
+    {
+        if (v.slope == -std::numeric_limits<double>::infinity()) return q.x >= v.x;
+        return q.y > v.y + v.slope * (q.x - v.x);
+    }
+
+    /**
+     * Whether p is on or below the chain, within its x-range.
+     */
+    bool covers(Point p) const
+    {
+        auto it = m_vertices.lower_bound(p.x);
+        if (it == m_vertices.end()) return false;
+        if (it->x == p.x) return p.y <= it->y;
+        if (it == m_vertices.begin()) return false;
+
+        return angle_gteq_pi(Line{*std::prev(it), *it}, Line{*it, p});
+    }
+
+    /**
+     * Adds p to the chain, unless it is covered. Returns whether it was added.
+     */
+    bool insert(Point p)
+    {
+        if (covers(p)) return false;
+
+        auto it = m_vertices.lower_bound(p.x);
+        if (it != m_vertices.end() && it->x == p.x) it = m_vertices.erase(it); // Below p.
+        it = m_vertices.insert(it, Vertex{p.x, p.y, 0});
+
+        // Neighbours between p and the next ones on each side must turn right.
+        while (it != m_vertices.begin() && std::prev(it) != m_vertices.begin()) {
+            auto prev = std::prev(it);
+            if (!angle_gteq_pi(Line{p, *prev}, Line{*prev, *std::prev(prev)})) break;
+            m_vertices.erase(prev);
+        }
+        for (auto next = std::next(it); next != m_vertices.end() && std::next(next) != m_vertices.end();) {
+            if (!angle_gteq_pi(Line{*std::next(next), *next}, Line{*next, p})) break;
+            next = m_vertices.erase(next);
+        }
+
+        update_slope(it);
+        if (it != m_vertices.begin()) update_slope(std::prev(it));
+        return true;
+    }
+
+    /**
+     * The vertex furthest in direction d, with d.y > 0. The chain must not be empty.
+     */
+    Point extreme(Vec2d d) const
+    {
+        return *m_vertices.lower_bound(Direction{d});
+    }
+
+    /**
+     * Ends of the range of vertices which q sees above the chain, or of the whole chain if q is beside it.
+     * Candidates for the tangents from q to the hull.
+     */
+    void tangent_candidates(Point q, PointSet &out) const
+    {
+        if (m_vertices.empty()) return;
+
+        out.push_back(*m_vertices.begin());
+        out.push_back(*m_vertices.rbegin());
+
+        auto first = m_vertices.lower_bound(FirstVisible{q});
+        if (first != m_vertices.end() && visible(*first, q)) out.push_back(*first);
+
+        auto last = m_vertices.lower_bound(LastVisible{q});
+        if (last != m_vertices.begin()) out.push_back(*std::prev(last));
+        if (last != m_vertices.end()) out.push_back(*last);
+    }
+
+    const Vertices &vertices() const { return m_vertices; }
+
+private:
+    void update_slope(Vertices::iterator it)
+    {
+        auto next = std::next(it);
+        it->slope = next == m_vertices.end() ? -std::numeric_limits<double>::infinity()
+                                              : (next->y - it->y) / (next->x - it->x);
+    }
+
+    Vertices m_vertices;
+};
+
+/**
+ * Convex hull of a stream of points. Points inside the hull are dropped as they come.
+ */
+class IncrementalHull
+{
+public:
+    /**
+     * Returns whether p is now on the hull.
+     */
+    bool insert(Point p)
+    {
+        bool upper = m_upper.insert(p);
+        bool lower = m_lower.insert(mirror(p));
+        return upper || lower;
+    }
+
+    template <class It>
+    void insert(It first, It last)
+    {
+        for (; first != last; ++first) insert(Point(*first));
+    }
+
+    /**
+     * Whether p is inside the hull or on its boundary.
+     */
+    bool contains(Point p) const
+    {
+        return m_upper.covers(p) && m_lower.covers(mirror(p));
+    }
+
+    /**
+     * The hull vertex furthest in direction d. The hull must not be empty.
+     */
+    Point extreme(Vec2d d) const
+    {
+        if (d.y > 0) return m_upper.extreme(d);
+        if (d.y < 0) return mirror(m_lower.extreme(Vec2d{d.x, -d.y}));
+
+        auto &vs = m_upper.vertices();
+        return d.x < 0 ? Point(*vs.begin()) : Point(*vs.rbegin());
+    }
+
+    /**
+     * Tangents from q, for q outside the hull: the hull is on the left of q->right and on the right of q->left.
+     * Returns false if q is inside the hull or on its boundary.
+     */
+    bool tangents(Point q, Point &right, Point &left) const
+    {
+        if (m_upper.vertices().empty() || contains(q)) return false;
+
+        PointSet candidates;
+        m_upper.tangent_candidates(q, candidates);
+        std::size_t upper = candidates.size();
+        m_lower.tangent_candidates(mirror(q), candidates);
+        for (std::size_t i = upper; i < candidates.size(); ++i) candidates[i] = mirror(candidates[i]);
+
+        // All of the hull is within less than half a turn around q.
+        right = left = candidates[0];
+        for (Point c : candidates)
+        {
+            Vec2d qc = c - q;
+            Vec2d qr = right - q;
+            Vec2d ql = left - q;
+            if (qr.x * qc.y - qr.y * qc.x < 0) right = c;
+            if (ql.x * qc.y - ql.y * qc.x > 0) left = c;
+        }
+        return true;
+    }
+
+    /**
+     * Counter-clockwise from graham_scan's pivot, as the other hulls.
+     */
+    PointSet hull() const
+    {
+        PointSet ch;
+        for (auto &v : m_lower.vertices()) ch.push_back(mirror(v));
+        for (auto it = m_upper.vertices().rbegin(); it != m_upper.vertices().rend(); ++it)
+        {
+            Point p = *it;
+            if (ch.empty() || ch.back().x != p.x || ch.back().y != p.y) ch.push_back(p);
+        }
+        if (ch.size() > 1 && ch.front().x == ch.back().x && ch.front().y == ch.back().y) ch.pop_back();
+
+        start_at_pivot(ch);
+        return ch;
+    }
+
+private:
+    static Point mirror(Point p) { return Point{p.x, -p.y}; }
+
+    HullChain m_upper;
+    HullChain m_lower; // Upper chain of the mirrored points.
+};
+
+// Rotating calipers: O(h) over a convex hull (counter-clockwise, no collinear points, as graham_scan's).
+// For each edge in turn, the vertices furthest from it, furthest ahead along it and furthest behind it are
+// found by pointers which only ever move forward around the hull, so each goes round once.
+// - The furthest pair of points is a pair of antipodal vertices: an edge's end and its furthest vertex.
+// - The minimum width, and the minimum area/perimeter enclosing rectangles, have a side on an edge of the hull.
+
+struct FurthestPairResult
+{
+    std::pair<Point, Point> furthest_pair;
+    double squared_distance = 0;
+};
+
+struct EnclosingRectangle
+{
+    std::array<Point, 4> corners; // Counter-clockwise, the first two on an edge of the hull.
+    double area = 0;
+    double perimeter = 0;
+};
+
+struct CalipersResult
+{
+    FurthestPairResult diameter;
+    double width = 0; // Smallest distance between two parallel lines enclosing the hull.
+    EnclosingRectangle min_area;
+    EnclosingRectangle min_perimeter;
+};
+
+/**
+ * Diameter, width and minimum enclosing rectangles of a convex hull in one turn of the calipers.
+ */
+inline CalipersResult rotating_calipers(const PointSet &hull)
+{
+    CalipersResult res;
+    std::size_t h = hull.size();
+    if (h == 0) return res;
+    if (h == 1) {
+        res.diameter.furthest_pair = {hull[0], hull[0]};
+        res.min_area.corners.fill(hull[0]);
+        res.min_perimeter.corners.fill(hull[0]);
+        return res;
+    }
+
+    auto dot = [](Vec2d a, Vec2d b) { return a.x * b.x + a.y * b.y; };
+    auto cross = [](Vec2d a, Vec2d b) { return a.x * b.y - a.y * b.x; };
+    auto at = [&](std::size_t i) { return hull[i % h]; };
+    auto check_pair = [&](Point p1, Point p2) {
+        double d = problem2::squared_vec_abs(p2 - p1);
+        if (d > res.diameter.squared_distance) res.diameter = FurthestPairResult{{p1, p2}, d};
+    };
+
+    res.width = std::numeric_limits<double>::max();
+    res.min_area.area = std::numeric_limits<double>::max();
+    res.min_perimeter.perimeter = std::numeric_limits<double>::max();
+
+    // ahead: furthest along the edge, far: furthest from it, behind: furthest back along it.
+    std::size_t ahead = 1, far = 1, behind = 1;
+    for (std::size_t i = 0; i < h; ++i)
+    {
+        Point p = hull[i];
+        Vec2d e = at(i + 1) - p;
+        if (i == 0) {
+            while (dot(e, at(ahead + 1) - p) > dot(e, at(ahead) - p)) ++ahead;
+            far = ahead;
+        }
+        ahead = std::max(ahead, i + 1);
+        while (dot(e, at(ahead + 1) - p) > dot(e, at(ahead) - p)) ++ahead;
+        far = std::max(far, ahead);
+        while (cross(e, at(far + 1) - p) > cross(e, at(far) - p)) ++far;
+        if (i == 0) behind = far;
+        behind = std::max(behind, far);
+        while (dot(e, at(behind + 1) - p) < dot(e, at(behind) - p)) ++behind;
+
+        check_pair(p, at(far));
+        check_pair(at(i + 1), at(far));
+        check_pair(at(i + 1), at(far + 1)); // In case an edge at far is parallel to e.
+
+        double len = std::sqrt(dot(e, e));
+        Vec2d u{e.x / len, e.y / len};
+        Vec2d n{-u.y, u.x}; // Towards the inside of the hull.
+        double height = cross(u, at(far) - p);
+        double front = dot(u, at(ahead) - p);
+        double back = dot(u, at(behind) - p);
+
+        res.width = std::min(res.width, height);
+
+        EnclosingRectangle rect;
+        rect.corners = {Point{p.x + u.x * back, p.y + u.y * back},
+                        Point{p.x + u.x * front, p.y + u.y * front},
+                        Point{p.x + u.x * front + n.x * height, p.y + u.y * front + n.y * height},
+                        Point{p.x + u.x * back + n.x * height, p.y + u.y * back + n.y * height}};
+        rect.area = (front - back) * height;
+        rect.perimeter = 2 * (front - back + height);
+        if (rect.area < res.min_area.area) res.min_area = rect;
+        if (rect.perimeter < res.min_perimeter.perimeter) res.min_perimeter = rect;
+    }
+    return res;
+}
+
+inline FurthestPairResult furthest_pair(const PointSet &hull)
+{
+    return rotating_calipers(hull).diameter;
+}
+
+inline double min_width(const PointSet &hull)
+{
+    return rotating_calipers(hull).width;
+}
+
+inline EnclosingRectangle min_area_rectangle(const PointSet &hull)
+{
+    return rotating_calipers(hull).min_area;
+}
+
+inline EnclosingRectangle min_perimeter_rectangle(const PointSet &hull)
+{
+    return rotating_calipers(hull).min_perimeter;
+}
+
+/**
+ * rotating_calipers for each of many hulls, spread over threads in blocks (the hulls are expected small).
+ */
+inline std::vector<CalipersResult> rotating_calipers(const std::vector<PointSet> &hulls, unsigned threads = hardware_threads())
+{
+    constexpr std::size_t block = 256;
+    std::vector<CalipersResult> res(hulls.size());
+    parallel_for((hulls.size() + block - 1) / block, [&](std::size_t b) {
+        for (std::size_t i = b * block, end = std::min(hulls.size(), i + block); i < end; ++i)
+        {
+            res[i] = rotating_calipers(hulls[i]);
+        }
+    }, threads);
+    return res;
+}
+
+// Operations on two convex hulls (counter-clockwise from the pivot, no collinear points, as graham_scan's),
+// in O(n + m) rather than computing the hull of all their points again:
+// - The vertices of a hull in order of x-coord are its lower and its upper chains merged. The vertices
+//   of two hulls, so sorted, are merged again, and the scan of the monotone chain is linear on sorted points.
+// - Intersection (O'Rourke): one edge of each polygon is followed at a time. Whichever edge "aims" at the
+//   other one, without being past it, moves forward; where the edges cross, the polygon which is inside
+//   changes, and so does the one whose vertices go out. Each edge is passed at most twice.
+// - Minkowski sum: the edges of both, in order of angle, from the sum of their pivots.
+// - Merging many hulls: pairs of them in parallel, then pairs of the results, and so on: log k rounds.
+// The results are hulls themselves: counter-clockwise from the pivot, without collinear points.
+
+/**
+ * Appends the vertices of a convex hull (counter-clockwise) to out, in order of x-coord then y-coord.
+ */
+inline void sorted_vertices(const PointSet &hull, PointSet &out)
+{
+    auto xy_less = [](Point a, Point b) { return a.x < b.x || (a.x == b.x && a.y < b.y); };
+    std::size_t h = hull.size();
+    if (h == 0) return;
+
+    // The lower chain from the leftmost vertex to the rightmost one, then the upper chain back.
+    std::size_t left = std::min_element(hull.begin(), hull.end(), xy_less) - hull.begin();
+    std::size_t right = std::max_element(hull.begin(), hull.end(), xy_less) - hull.begin();
+    std::size_t lower_size = (right + h - left) % h + 1;
+    std::size_t first = out.size();
+    out.resize(first + h);
+
+    Point *lower = out.data() + first;
+    for (std::size_t i = 0; i < lower_size; ++i) lower[i] = hull[(left + i) % h];
+
+    // The upper chain reversed, without the two ends, after it, then the two merged.
+    Point *upper = lower + lower_size;
+    for (std::size_t i = h - lower_size; i > 0; --i) *upper++ = hull[(right + i) % h];
+    std::inplace_merge(lower, lower + lower_size, lower + h, xy_less);
+}
+
+/**
+ * Removes copies of consecutive points and vertices which don't turn left from a convex polygon
+ * (counter-clockwise), and rotates it to start at the pivot.
+ */
+inline void tidy_hull(PointSet &hull)
+{
+    auto same = [](Point a, Point b) { return a.x == b.x && a.y == b.y; };
+    hull.erase(std::unique(hull.begin(), hull.end(), same), hull.end());
+    while (hull.size() > 1 && same(hull.front(), hull.back())) hull.pop_back();
+    if (hull.size() < 3) {
+        start_at_pivot(hull);
+        return;
+    }
+
+    // Graham's scan from the pivot: the polygon is already in order of angle around it.
+    start_at_pivot(hull);
+    std::size_t m = 1;
+    for (std::size_t k = 1; k <= hull.size(); ++k)
+    {
+        Point p = hull[k % hull.size()];
+        while (m >= 2 && angle_gteq_pi(Line{hull[m - 2], hull[m - 1]}, Line{hull[m - 1], p})) --m;
+        if (k < hull.size()) hull[m++] = p;
+    }
+    hull.resize(m);
+}
+
+/**
+ * Hull of the points of two hulls.
+ */
+inline PointSet merge_hulls(const PointSet &a, const PointSet &b)
+{
+    PointSet sorted;
+    sorted.reserve(a.size() + b.size());
+    sorted_vertices(a, sorted);
+    sorted_vertices(b, sorted);
+    std::inplace_merge(sorted.begin(), sorted.begin() + a.size(), sorted.end(), [](Point p, Point q) {
+        return p.x < q.x || (p.x == q.x && p.y < q.y);
+    });
+    sorted.erase(std::unique(sorted.begin(), sorted.end(), [](Point p, Point q) { return p.x == q.x && p.y == q.y; }),
+                 sorted.end());
+
+    PointSet hull(2 * sorted.size());
+    hull.resize(monotone_chain_sorted(sorted.begin(), sorted.end(), hull.data()));
+    start_at_pivot(hull);
+    return hull;
+}
+
+/**
+ * Hull of the points of all the hulls, merged two by two in parallel.
+ */
+inline PointSet merge_hulls(std::vector<PointSet> hulls, unsigned threads = hardware_threads())
+{
+    if (hulls.empty()) return {};
+    while (hulls.size() > 1)
+    {
+        std::size_t pairs = hulls.size() / 2;
+        parallel_for(pairs, [&](std::size_t i) {
+            hulls[i] = merge_hulls(hulls[2 * i], hulls[2 * i + 1]);
+        }, threads);
+        if (hulls.size() % 2) hulls[pairs] = std::move(hulls.back());
+        hulls.resize((hulls.size() + 1) / 2);
+    }
+    return std::move(hulls.front());
+}
+
+/**
+ * Point where segments a1-a2 and b1-b2 cross, from their orientations: those of b1 and b2 to a1->a2.
+ */
+inline Point crossing(Point a1, Point a2, Point b1, Point b2)
+{
+    double d1 = predicates::orient2d(a1, a2, b1);
+    double d2 = predicates::orient2d(a1, a2, b2);
+    double t = d1 / (d1 - d2);
+    return Point{b1.x + t * (b2.x - b1.x), b1.y + t * (b2.y - b1.y)};
+}
+
+/**
+ * Part of segment p-q inside a convex polygon of at least 3 vertices (counter-clockwise): 0, 1 or 2 points.
+ */
+inline PointSet clip_segment(Point p, Point q, const PointSet &convex)
+{
+    double t0 = 0, t1 = 1;
+    for (std::size_t i = 0, h = convex.size(); i < h; ++i)
+    {
+        Point a = convex[i], b = convex[(i + 1) % h];
+        double f0 = predicates::orient2d(a, b, p);
+        double f1 = predicates::orient2d(a, b, q);
+        if (f0 < 0 && f1 < 0) return {};
+        if (f0 < 0) t0 = std::max(t0, f0 / (f0 - f1));
+        if (f1 < 0) t1 = std::min(t1, f0 / (f0 - f1));
+        if (t0 > t1) return {};
+    }
+    auto at = [&](double t) { return t == 0 ? p : t == 1 ? q : Point{p.x + t * (q.x - p.x), p.y + t * (q.y - p.y)}; };
+    PointSet res{at(t0), at(t1)};
+    tidy_hull(res);
+    return res;
+}
+
+/**
+ * Intersection of two convex hulls. It may be a segment or a point (or empty) if they only touch.
+ */
+inline PointSet intersect_hulls(const PointSet &p, const PointSet &q)
+{
+    std::size_t n = p.size(), m = q.size();
+    if (n == 0 || m == 0) return {};
+
+    // Points and segments are clipped.
+    if (n < 3 || m < 3) {
+        if (n >= 3) return clip_segment(q.front(), q.back(), p);
+        if (m >= 3) return clip_segment(p.front(), p.back(), q);
+        Line s1{p.front(), p.back()}, s2{q.front(), q.back()};
+        if (!intersect(s1, s2)) return {};
+        PointSet res;
+        if (predicates::orient2d(s1.p1, s1.p2, s2.p1) == 0 && predicates::orient2d(s1.p1, s1.p2, s2.p2) == 0) {
+            // On one line: the middle two of the four ends.
+            PointSet ends{s1.p1, s1.p2, s2.p1, s2.p2};
+            std::sort(ends.begin(), ends.end(), [](Point a, Point b) { return a.x < b.x || (a.x == b.x && a.y < b.y); });
+            res = {ends[1], ends[2]};
+        } else {
+            res = {crossing(s1.p1, s1.p2, s2.p1, s2.p2)};
+        }
+        tidy_hull(res);
+        return res;
+    }
+
+    enum class Inside { unknown, p, q };
+    Inside inside = Inside::unknown;
+    PointSet res;
+    std::size_t a = 0, b = 0;   // Edges p[a - 1]->p[a] and q[b - 1]->q[b].
+    std::size_t aa = 0, ba = 0; // Steps taken on each.
+    auto advance = [&](std::size_t &i, std::size_t &steps, std::size_t size, bool in, const PointSet &poly) {
+        if (in) res.push_back(poly[i]);
+        ++steps;
+        i = (i + 1) % size;
+    };
+
+    do
+    {
+        Point a1 = p[(a + n - 1) % n], a2 = p[a];
+        Point b1 = q[(b + m - 1) % m], b2 = q[b];
+        Vec2d ea = a2 - a1, eb = b2 - b1;
+        double turn = ea.x * eb.y - ea.y * eb.x;
+        double a_side = predicates::orient2d(b1, b2, a2); // > 0: the head of a is inside b's edge.
+        double b_side = predicates::orient2d(a1, a2, b2);
+        double a1_side = predicates::orient2d(b1, b2, a1);
+        double b1_side = predicates::orient2d(a1, a2, b1);
+
+        bool collinear = a_side == 0 && a1_side == 0;
+        bool cross = !collinear && !(a1_side > 0 && a_side > 0) && !(a1_side < 0 && a_side < 0) &&
+                     !(b1_side > 0 && b_side > 0) && !(b1_side < 0 && b_side < 0);
+        if (cross) {
+            // The polygon whose edge heads inside the other's is now the inside one.
+            if (inside == Inside::unknown && res.empty()) aa = ba = 0; // Go round once more from here.
+            res.push_back(crossing(b1, b2, a1, a2));
+            if (a_side > 0) inside = Inside::p;
+            else if (b_side > 0) inside = Inside::q;
+        }
+
+        if (collinear && ea.x * eb.x + ea.y * eb.y < 0 && bounding_box_collision(Line{a1, a2}, Line{b1, b2})) {
+            // Edges overlapping the opposite way: the polygons only share (part of) them.
+            res = intersect_hulls(PointSet{a1, a2}, PointSet{b1, b2});
+            return res;
+        }
+        if (turn == 0 && a_side < 0 && b_side < 0) return {}; // Parallel edges, back to back: apart.
+
+        if (turn == 0 && a_side == 0 && b_side == 0) {
+            if (inside == Inside::p) advance(b, ba, m, inside == Inside::q, q);
+            else advance(a, aa, n, inside == Inside::p, p);
+        } else if (turn >= 0) {
+            if (b_side > 0) advance(a, aa, n, inside == Inside::p, p);
+            else advance(b, ba, m, inside == Inside::q, q);
+        } else {
+            if (a_side > 0) advance(b, ba, m, inside == Inside::q, q);
+            else advance(a, aa, n, inside == Inside::p, p);
+        }
+    } while ((aa < n || ba < m) && aa < 2 * n && ba < 2 * m);
+
+    if (inside == Inside::unknown) {
+        // The edges never crossed: one polygon is inside the other, or they are apart (or touch).
+        // A point inside each polygon tells which: if both are in the other one, the smaller one is inside.
+        auto contains = [](const PointSet &poly, const PointSet &other) {
+            Point x{(other[0].x + other[1].x + other[2].x) / 3, (other[0].y + other[1].y + other[2].y) / 3};
+            for (std::size_t i = 0; i < poly.size(); ++i)
+            {
+                if (predicates::orient2d(poly[i], poly[(i + 1) % poly.size()], x) < 0) return false;
+            }
+            return true;
+        };
+        auto area = [](const PointSet &poly) {
+            double a = 0;
+            for (std::size_t i = 0; i < poly.size(); ++i)
+            {
+                Point u = poly[i], v = poly[(i + 1) % poly.size()];
+                a += u.x * v.y - u.y * v.x;
+            }
+            return a;
+        };
+        bool p_in_q = contains(q, p), q_in_p = contains(p, q);
+        if (p_in_q && q_in_p) return area(p) <= area(q) ? p : q;
+        if (p_in_q) return p;
+        if (q_in_p) return q;
+    }
+    tidy_hull(res);
+    return res;
+}
+
+/**
+ * Minkowski sum of two convex hulls: the points x + y, x in the first one and y in the second.
+ */
+inline PointSet minkowski_sum(const PointSet &p, const PointSet &q)
+{
+    std::size_t n = p.size(), m = q.size();
+    if (n == 0 || m == 0) return {};
+
+    // Both start at their pivot (greatest x-coord, smallest y-coord): so does the sum.
+    PointSet res;
+    res.reserve(n + m);
+    std::size_t i = 0, j = 0;
+    while (i < n || j < m)
+    {
+        res.push_back(Point{p[i % n].x + q[j % m].x, p[i % n].y + q[j % m].y});
+        Vec2d ep = p[(i + 1) % n] - p[i % n];
+        Vec2d eq = q[(j + 1) % m] - q[j % m];
+        double turn = ep.x * eq.y - ep.y * eq.x;
+        bool next_p = j == m || (i < n && turn >= 0);
+        bool next_q = i == n || (j < m && turn <= 0);
+        if (next_p) ++i;
+        if (next_q) ++j;
+    }
+    tidy_hull(res);
+    return res;
+}
+
+} // end namespace problem3
+
+#endif //UNTITLED_LECTURE2_H
@@ -2,9 +2,15 @@
 // Created by bruno on 17/01/18.
 //
 
-#include <cassert>
 #include <cmath>
+#include <cstring>
+#include <iostream>
+
 #include "common.h"
+#include "external.h"
+#include "instrument.h"
+#include "lecture3.h"
+#include "pointset_io.h"
 
 namespace problem4 {
 
@@ -32,97 +38,6 @@ const char description[] = R"(
 // - Compare each point against the next 5 successors (max 6 points can be in the given region)
 )";
 
-struct ClosestPairResult
-{
-    std::pair<Point, Point> closest_pair;
-    double squared_distance; // Use squared distance as it's faster to compute.
-
-    ClosestPairResult(Point p1, Point p2) : closest_pair{p1, p2}
-    {
-        squared_distance = std::pow((p1.x - p2.x), 2) + std::pow((p1.y - p2.y), 2);
-    }
-
-    ClosestPairResult(Point p1) : closest_pair{p1, p1}
-    {
-        // Consider distance to itself to be infinite.
-        squared_distance = std::numeric_limits<double>::max();
-    }
-
-    ClosestPairResult() : ClosestPairResult(Point{}) {};
-
-    bool operator <(const ClosestPairResult &rhs) const {
-        return squared_distance < rhs.squared_distance;
-    }
-};
-
-/** returns a PointSet containing points in range with
-  * x-coord within dist of orig; preserves relative order
-  **/
-PointSet filter_x(PointSet &ps, range<PointSet::iterator> rng, double dist, double orig)
-{
-    PointSet result;
-    std::copy_if(rng.begin(), rng.end(), std::back_inserter(result), [=](Point p) {
-        return std::abs(p.x - orig) <= dist;
-    });
-
-    return result;
-}
-
-
-/*
- * Assumes p[range_start...range_end] sorted on x-coord;
- * Returns the closest pair of points in p[range_start...range_end].
- * ps is also modified so that the points in [range_start...range_end] are now sorted by y-coord.
- */
-ClosestPairResult closest_pair_rec_impl(PointSet &ps, range<PointSet::iterator> rng)
-{
-    assert(rng.size() > 0 && "The range must contain at least 1 element.");
-
-    // Base case
-    if (rng.size() == 1) {
-        return {rng.first()};
-    }
-
-    // Split the range around the middle
-    auto [left_range, right_range] = rng.split_at(rng.size() / 2);
-    double mid_x = (left_range.last().x + right_range.first().x) / 2.0;
-
-    auto closest_left =  closest_pair_rec_impl(ps, left_range);
-    auto closest_right = closest_pair_rec_impl(ps, right_range);
-
-    // Merge the two sides of the pointSet based on the y-coord.
-    std::inplace_merge(left_range.begin(), left_range.end(), right_range.end(), [](Point p1, Point p2) {
-        return p1.y < p2.y;
-    });
-
-    ClosestPairResult closest = std::min(closest_left, closest_right);
-    PointSet filtered = filter_x(ps, rng, closest.squared_distance, mid_x);
-
-    if (filtered.empty()) {
-        return closest;
-    }
-
-    // Iterate over each remaining point after filtering:
-    for (size_t j = 0, len_filt = filtered.size(); j < len_filt - 1; ++j) {
-        // Compare each of the points with the next 5 elements (or less if len_filt is smaller)
-        for (size_t k = j + 1; k < std::min(j + 6, len_filt); ++k) {
-            ClosestPairResult tentative{filtered[j], filtered[k]};
-            if (tentative < closest) {
-                closest = tentative;
-            }
-        }
-    }
-    return closest;
-}
-
-ClosestPairResult closest_pair(PointSet ps)
-{
-    // Sort on x coordinates.
-    std::sort(ps.begin(), ps.end(), [](Point a, Point b) { return a.x < b.x; });
-
-    return closest_pair_rec_impl(ps, {ps.begin(), ps.end()});
-}
-
 const char analysis[] = R"(
 // Analysis of the algorithm:
 
@@ -134,22 +49,48 @@ const char analysis[] = R"(
 //   - f(1) = d
 
 // Hence, f(n) = O(n log n) as for mergesort.
+
+// The parallel version runs the two recursive calls at the same time: with p threads the top levels,
+// which have the biggest merges, are shared out, and the remaining levels take O(n log n / p).
+
+// The grid version is expected O(n) whatever the input, as the expectation is over its own random order.
+// Each point costs a few random accesses to the hash table though, so it is the faster one while the
+// table stays in the caches (up to around a million points), and divide and conquer is beyond.
+// k_closest_pairs and pairs_within are O(n + pairs found) for points spread evenly enough.
 )";
 
-void run()
+void print(const ClosestPairResult &res)
 {
-    PointSet ps = ask_pointset();
-    auto res = problem4::closest_pair(ps);
     auto [p1, p2] = res.closest_pair;
     std::cout << "Smallest distance is " << std::sqrt(res.squared_distance)
               << " between points " << p1 << " " << p2 << std::endl;
+    if (instrument::enabled) {
+        std::cerr << "Stats: ";
+        instrument::dump(std::cerr, instrument::snapshot());
+        std::cerr << std::endl;
+    }
+}
+
+template <class Points>
+void run(const Points &ps)
+{
+    print(problem4::closest_pair_parallel(ps));
 }
 
 } //end namespace problem4
 
-int main()
+int main(int argc, char *argv[])
 {
     std::cout << problem4::description << std::endl;
-    problem4::run();
+    // Points are read from the file given as argument, if any (text or binary point file).
+    // With --external, the file is read a chunk at a time, for files larger than memory.
+    if (argc > 2 && std::strcmp(argv[2], "--external") == 0) {
+        problem4::print(problem4::external_closest_pair(argv[1]));
+    } else if (argc > 1 && is_point_file(argv[1])) {
+        MappedPointSet mps(argv[1]);
+        problem4::run(mps.view());
+    } else {
+        problem4::run(argc > 1 ? load_pointset(argv[1]) : ask_pointset());
+    }
     std::cout << problem4::analysis << std::endl;
 }
@@ -0,0 +1,1350 @@
+//
+// Created by bruno on 17/01/18.
+//
+
+#ifndef UNTITLED_LECTURE3_H
+#define UNTITLED_LECTURE3_H
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include "common.h"
+#include "instrument.h"
+#include "parallel.h"
+#include "predicates.h"
+
+namespace problem4 {
+
+/**
+ * Closest pair for coordinates of type T (see predicates::Kernel): squared distances are in the kernel's
+ * wide type, exact for integer coordinates.
+ */
+template <class T>
+struct BasicClosestPairResult
+{
+    using Distance = typename predicates::Kernel<T>::wide;
+
+    std::pair<BasicPoint<T>, BasicPoint<T>> closest_pair;
+    Distance squared_distance; // Use squared distance as it's faster to compute.
+
+    BasicClosestPairResult(BasicPoint<T> p1, BasicPoint<T> p2) : closest_pair{p1, p2}
+    {
+        squared_distance = predicates::squared_distance(p1, p2);
+    }
+
+    BasicClosestPairResult(BasicPoint<T> p1) : closest_pair{p1, p1}
+    {
+        // Consider distance to itself to be infinite.
+        squared_distance = predicates::Kernel<T>::infinite_distance;
+    }
+
+    BasicClosestPairResult() : BasicClosestPairResult(BasicPoint<T>{}) {};
+
+    bool operator <(const BasicClosestPairResult &rhs) const {
+        return squared_distance < rhs.squared_distance;
+    }
+};
+
+using ClosestPairResult = BasicClosestPairResult<double>;
+
+/**
+ * The strip around the dividing line x = (left_x + right_x) / 2, as wide as the closest distance on each side.
+ * Floating-point coordinates are compared to the distance, integers to its square, exactly.
+ */
+template <class T>
+class Strip
+{
+public:
+    using Distance = typename predicates::Kernel<T>::wide;
+
+    Strip(T left_x, T right_x, Distance squared_distance)
+        : m_left_x(left_x), m_right_x(right_x), m_squared_distance(squared_distance),
+          m_mid_x((left_x + right_x) / 2.0), m_dist(std::sqrt(double(squared_distance))) {}
+
+    bool contains(BasicPoint<T> p) const
+    {
+        if constexpr (predicates::Kernel<T>::exact) {
+            Distance dx = 2 * Distance(p.x) - Distance(m_left_x) - Distance(m_right_x);
+            return dx * dx <= 4 * m_squared_distance;
+        } else {
+            return std::abs(p.x - m_mid_x) <= m_dist;
+        }
+    }
+
+private:
+    T m_left_x;
+    T m_right_x;
+    Distance m_squared_distance;
+    double m_mid_x;
+    double m_dist;
+};
+
+/** returns the points in range within the strip; preserves relative order
+  **/
+template <class It, class T>
+std::vector<BasicPoint<T>> filter_x(range<It> rng, const Strip<T> &strip)
+{
+    INSTRUMENT_PHASE(filter);
+    std::vector<BasicPoint<T>> result;
+    std::copy_if(rng.begin(), rng.end(), std::back_inserter(result), [&](BasicPoint<T> p) {
+        return strip.contains(p);
+    });
+    INSTRUMENT_ALLOC(result.capacity() * sizeof(BasicPoint<T>));
+
+    return result;
+}
+
+
+/*
+ * Assumes p[range_start...range_end] sorted on x-coord;
+ * Returns the closest pair of points in p[range_start...range_end].
+ * The points in [range_start...range_end] are also modified so that they are now sorted by y-coord.
+ */
+template <class T>
+BasicClosestPairResult<T> closest_pair_rec_impl(range<typename std::vector<BasicPoint<T>>::iterator> rng)
+{
+    using P = BasicPoint<T>;
+    assert(rng.size() > 0 && "The range must contain at least 1 element.");
+
+    // Base case
+    if (rng.size() == 1) {
+        return {rng.first()};
+    }
+
+    // Split the range around the middle
+    auto [left_range, right_range] = rng.split_at(rng.size() / 2);
+    T left_x = left_range.last().x;
+    T right_x = right_range.first().x;
+
+    auto closest_left =  closest_pair_rec_impl<T>(left_range);
+    auto closest_right = closest_pair_rec_impl<T>(right_range);
+
+    // Merge the two sides of the pointSet based on the y-coord.
+    {
+        INSTRUMENT_PHASE(merge);
+        std::inplace_merge(left_range.begin(), left_range.end(), right_range.end(), [](P p1, P p2) {
+            INSTRUMENT_COUNT(comparisons, 1);
+            return p1.y < p2.y;
+        });
+    }
+
+    BasicClosestPairResult<T> closest = std::min(closest_left, closest_right);
+    std::vector<P> filtered = filter_x(rng, Strip<T>{left_x, right_x, closest.squared_distance});
+
+    INSTRUMENT_COUNT(strips, 1);
+    INSTRUMENT_COUNT(strip_points, filtered.size());
+    INSTRUMENT_MAX(max_strip, filtered.size());
+    if (filtered.empty()) {
+        return closest;
+    }
+
+    INSTRUMENT_PHASE(scan);
+    // Iterate over each remaining point after filtering:
+    for (size_t j = 0, len_filt = filtered.size(); j < len_filt - 1; ++j) {
+        // Compare each of the points with the next 5 elements (or less if len_filt is smaller)
+        for (size_t k = j + 1; k < std::min(j + 6, len_filt); ++k) {
+            INSTRUMENT_COUNT(distance_checks, 1);
+            BasicClosestPairResult<T> tentative{filtered[j], filtered[k]};
+            if (tentative < closest) {
+                closest = tentative;
+            }
+        }
+    }
+    return closest;
+}
+
+/**
+ * Closest pair of the points in pts, which are left untouched: the recursion works on its own copy.
+ * The initial sort is skipped if the points are known to be sorted on the x-coord already.
+ */
+template <class It>
+auto closest_pair(range<It> pts, bool sorted_by_x = false)
+{
+    using P = typename std::iterator_traits<It>::value_type;
+    std::vector<P> ps(pts.begin(), pts.end());
+    INSTRUMENT_ALLOC(ps.size() * sizeof(P));
+
+    // Sort on x coordinates.
+    if (!sorted_by_x) {
+        INSTRUMENT_PHASE(sort);
+        std::sort(ps.begin(), ps.end(), [](P a, P b) {
+            INSTRUMENT_COUNT(comparisons, 1);
+            return a.x < b.x;
+        });
+    }
+
+    return closest_pair_rec_impl<typename P::coordinate_type>({ps.begin(), ps.end()});
+}
+
+template <class T>
+BasicClosestPairResult<T> closest_pair(const std::vector<BasicPoint<T>> &ps)
+{
+    return closest_pair(range(ps.begin(), ps.end()));
+}
+
+/**
+ * Same as closest_pair, reading the points in place (eg. from a mapped point file).
+ */
+inline ClosestPairResult closest_pair(const PointView &pv)
+{
+    return closest_pair(range(pv.begin(), pv.end()), pv.sorted_by_x());
+}
+
+// Parallel closest pair, without allocations during the run.
+// - One workspace holds every buffer: the points sorted on x, two buffers of n points where the recursion
+//   leaves each range sorted on y, and a strip buffer. A call for a range reads its points sorted on x,
+//   lets its two halves sort themselves on y into one buffer and merges them into the other: the buffers swap
+//   roles at each level. Its strip goes in the same range of the strip buffer, so ranges never overlap.
+// - Above a cutoff size the two halves are run as parallel tasks on a work-stealing pool.
+//   The initial sort on x is a parallel merge sort on the same buffers.
+
+/**
+ * Buffers for closest_pair_parallel, grown as needed and kept between calls.
+ */
+struct ClosestPairWorkspace
+{
+    PointSet by_x;
+    PointSet by_y;
+    PointSet scratch; // Ping-pong partner of by_y, and of by_x while sorting on x.
+    PointSet strip;
+
+    void resize(std::size_t n)
+    {
+        if (by_x.size() < n) {
+            INSTRUMENT_ALLOC(4 * (n - by_x.size()) * sizeof(Point));
+            by_x.resize(n);
+            by_y.resize(n);
+            scratch.resize(n);
+            strip.resize(n);
+        }
+    }
+};
+
+// Ranges with fewer points are handled by a single task.
+constexpr std::size_t closest_pair_cutoff = 1 << 13;
+
+/**
+ * Sorts ws.by_x[lo...hi) on x-coord, in pieces of at most leaf points sorted in parallel, then merged.
+ */
+inline void sort_on_x(ClosestPairWorkspace &ws, WorkStealingPool &pool, std::size_t lo, std::size_t hi, std::size_t leaf)
+{
+    auto x_less = [](Point a, Point b) {
+        INSTRUMENT_COUNT(comparisons, 1);
+        return a.x < b.x;
+    };
+    if (hi - lo <= leaf) {
+        INSTRUMENT_PHASE(sort);
+        std::sort(ws.by_x.begin() + lo, ws.by_x.begin() + hi, x_less);
+        return;
+    }
+
+    std::size_t mid = lo + (hi - lo) / 2;
+    pool.fork_join([&] { sort_on_x(ws, pool, lo, mid, leaf); }, [&] { sort_on_x(ws, pool, mid, hi, leaf); });
+    INSTRUMENT_PHASE(sort);
+    std::merge(ws.by_x.begin() + lo, ws.by_x.begin() + mid, ws.by_x.begin() + mid, ws.by_x.begin() + hi,
+               ws.scratch.begin() + lo, x_less);
+    std::copy(ws.scratch.begin() + lo, ws.scratch.begin() + hi, ws.by_x.begin() + lo);
+}
+
+/**
+ * std::merge on the y-coord, without branching on the comparison: which side comes next is random.
+ */
+inline void merge_on_y(const Point *a, const Point *mid, const Point *end, Point *out)
+{
+    const Point *b = mid;
+    while (a != mid && b != end)
+    {
+        bool take_b = b->y < a->y;
+        *out++ = take_b ? *b : *a;
+        b += take_b;
+        a += !take_b;
+    }
+    out = std::copy(a, mid, out);
+    std::copy(b, end, out);
+}
+
+/*
+ * Closest pair of ws.by_x[lo...hi), which also end up sorted on y-coord in out[lo...hi).
+ * other[lo...hi) is used as scratch.
+ */
+inline ClosestPairResult closest_pair_parallel_impl(ClosestPairWorkspace &ws, WorkStealingPool &pool,
+                                             std::size_t lo, std::size_t hi, Point *out, Point *other)
+{
+    // Base case: brute force, and insertion sort on y.
+    if (hi - lo <= 8) {
+        ClosestPairResult closest{ws.by_x[lo]};
+        for (std::size_t i = lo; i < hi; ++i)
+        {
+            Point p = ws.by_x[i];
+            std::size_t k = i;
+            for (; k > lo && p.y < out[k - 1].y; --k)
+            {
+                out[k] = out[k - 1];
+            }
+            out[k] = p;
+
+            for (std::size_t j = lo; j < i; ++j)
+            {
+                ClosestPairResult tentative{ws.by_x[j], p};
+                if (tentative < closest) {
+                    closest = tentative;
+                }
+            }
+        }
+        return closest;
+    }
+
+    std::size_t mid = lo + (hi - lo) / 2;
+    double mid_x = (ws.by_x[mid - 1].x + ws.by_x[mid].x) / 2.0;
+
+    ClosestPairResult closest_left, closest_right;
+    auto left = [&] { closest_left = closest_pair_parallel_impl(ws, pool, lo, mid, other, out); };
+    auto right = [&] { closest_right = closest_pair_parallel_impl(ws, pool, mid, hi, other, out); };
+    if (hi - lo > closest_pair_cutoff) {
+        pool.fork_join(left, right);
+    } else {
+        left();
+        right();
+    }
+
+    {
+        INSTRUMENT_PHASE(merge);
+        merge_on_y(other + lo, other + mid, other + hi, out + lo);
+    }
+
+    ClosestPairResult closest = std::min(closest_left, closest_right);
+    double dist = std::sqrt(closest.squared_distance);
+    Point *strip = ws.strip.data() + lo;
+    Point *strip_end;
+    {
+        INSTRUMENT_PHASE(filter);
+        strip_end = std::copy_if(out + lo, out + hi, strip, [=](Point p) { return std::abs(p.x - mid_x) <= dist; });
+    }
+    INSTRUMENT_COUNT(strips, 1);
+    INSTRUMENT_COUNT(strip_points, strip_end - strip);
+    INSTRUMENT_MAX(max_strip, strip_end - strip);
+
+    // Compare each point of the strip with the next ones which are less than dist above it.
+    INSTRUMENT_PHASE(scan);
+    for (Point *p = strip; p != strip_end; ++p)
+    {
+        for (Point *q = p + 1; q != strip_end && std::pow(q->y - p->y, 2) < closest.squared_distance; ++q)
+        {
+            INSTRUMENT_COUNT(distance_checks, 1);
+            ClosestPairResult tentative{*p, *q};
+            if (tentative < closest) {
+                closest = tentative;
+            }
+        }
+    }
+    return closest;
+}
+
+/**
+ * Same result as closest_pair. The buffers of ws are reused, and only grown if pts has more points
+ * than any previous call.
+ */
+template <class It>
+ClosestPairResult closest_pair_parallel(range<It> pts, ClosestPairWorkspace &ws, WorkStealingPool &pool,
+                                        bool sorted_by_x = false)
+{
+    std::size_t n = pts.size();
+    if (n == 0) {
+        return {};
+    }
+
+    ws.resize(n);
+    std::copy(pts.begin(), pts.end(), ws.by_x.begin());
+    if (!sorted_by_x) {
+        // A few pieces per thread are enough to balance the load; every merge level is another pass.
+        sort_on_x(ws, pool, 0, n, std::max(closest_pair_cutoff, n / (4 * pool.size())));
+    }
+
+    return closest_pair_parallel_impl(ws, pool, 0, n, ws.by_y.data(), ws.scratch.data());
+}
+
+inline ClosestPairResult closest_pair_parallel(const PointSet &ps)
+{
+    ClosestPairWorkspace ws;
+    WorkStealingPool pool;
+    return closest_pair_parallel(range(ps.begin(), ps.end()), ws, pool);
+}
+
+inline ClosestPairResult closest_pair_parallel(const PointView &pv)
+{
+    ClosestPairWorkspace ws;
+    WorkStealingPool pool;
+    return closest_pair_parallel(range(pv.begin(), pv.end()), ws, pool, pv.sorted_by_x());
+}
+
+// Grid closest pair (randomized incremental, after Rabin and Khuller-Matias): expected O(n).
+// - Take the points in random order, with d the closest distance among the points so far.
+// - Points are hashed into square cells of side 2d, so a point closer than d to the new one is in one of the
+//   2x2 cells nearest to it, and each cell has O(1) points (they are at least d apart). Probing 4 cells
+//   rather than the 3x3 cells of side d means fewer cache misses in the hash table.
+// - When the new point is closer than d to one of them, the grid is rebuilt with the new d. In random order,
+//   the i-th point is in the closest pair of the first i with probability at most 2/i: the expected cost of
+//   the rebuilds is sum(i * 2/i) = O(n).
+
+/**
+ * Hash grid over (some of) the points of ps, for a given cell size. Cells are chained lists of point indices,
+ * in a table sized once for all the points, so rebuilding doesn't allocate.
+ */
+class PointGrid
+{
+public:
+    static constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+    explicit PointGrid(const PointSet &ps) : m_ps(ps), m_nodes(ps.size())
+    {
+        std::size_t capacity = 16;
+        while (capacity < 2 * ps.size()) capacity *= 2;
+        m_table.assign(capacity, Cell{0, 0, none});
+
+        m_min = m_max = ps.empty() ? Point{} : ps[0];
+        for (Point p : ps)
+        {
+            m_min = Point{std::min(m_min.x, p.x), std::min(m_min.y, p.y)};
+            m_max = Point{std::max(m_max.x, p.x), std::max(m_max.y, p.y)};
+        }
+    }
+
+    /**
+     * Empties the grid and sets the radius of for_each_near. Returns false if the cells would be too small
+     * to number across the points (eg. a radius of 0).
+     */
+    bool reset(double radius)
+    {
+        for (std::size_t slot : m_used) m_table[slot].head = none;
+        m_used.clear();
+
+        constexpr double max_cells = 1ll << 60;
+        m_radius = radius;
+        m_cell_size = 2 * radius;
+        return radius > 0 && (m_max.x - m_min.x) / m_cell_size < max_cells && (m_max.y - m_min.y) / m_cell_size < max_cells;
+    }
+
+    void insert(std::size_t i)
+    {
+        auto [cx, cy] = cell_of(m_ps[i]);
+        Cell &cell = m_table[find(cx, cy)];
+        if (cell.head == none) {
+            cell.cx = cx;
+            cell.cy = cy;
+            m_used.push_back(&cell - m_table.data());
+        }
+        m_nodes[i] = Node{m_ps[i], cell.head};
+        cell.head = i;
+    }
+
+    /**
+     * Calls fn(j, ps[j]) for each point j of the grid in the 2x2 cells nearest to p: all those within the radius.
+     */
+    template <class Fn>
+    void for_each_near(Point p, Fn &&fn) const
+    {
+        auto [cx, cy] = cell_of(Point{p.x - m_radius, p.y - m_radius});
+        for (std::int64_t x = cx; x <= cx + 1; ++x)
+        {
+            for (std::int64_t y = cy; y <= cy + 1; ++y)
+            {
+                for (std::size_t j = m_table[find(x, y)].head; j != none; j = m_nodes[j].next)
+                {
+                    fn(j, m_nodes[j].p);
+                }
+            }
+        }
+    }
+
+    /**
+     * Starts loading the slots which insert(p) or for_each_near(p) are going to read (no-op if unsupported).
+     * The table is far bigger than the caches, and the points come in random order.
+     */
+    void prefetch(Point p) const
+    {
+#if defined(__GNUC__)
+        auto [cx, cy] = cell_of(Point{p.x - m_radius, p.y - m_radius});
+        for (std::int64_t x = cx; x <= cx + 1; ++x)
+        {
+            for (std::int64_t y = cy; y <= cy + 1; ++y)
+            {
+                __builtin_prefetch(&m_table[slot_of(x, y)]);
+            }
+        }
+#endif
+    }
+
+private:
+    struct Cell
+    {
+        std::int64_t cx;
+        std::int64_t cy;
+        std::size_t head; // First point of the cell, none if the slot is free.
+    };
+
+    // Points of a cell are chained with a copy of their coordinates, so walking the chain reads one array.
+    struct Node
+    {
+        Point p;
+        std::size_t next;
+    };
+
+    std::pair<std::int64_t, std::int64_t> cell_of(Point p) const
+    {
+        return {static_cast<std::int64_t>(std::floor((p.x - m_min.x) / m_cell_size)),
+                static_cast<std::int64_t>(std::floor((p.y - m_min.y) / m_cell_size))};
+    }
+
+    /**
+     * First slot to probe for the cell.
+     */
+    std::size_t slot_of(std::int64_t cx, std::int64_t cy) const
+    {
+        std::uint64_t h = static_cast<std::uint64_t>(cx) * 0x9E3779B97F4A7C15ull ^ static_cast<std::uint64_t>(cy) * 0xC2B2AE3D27D4EB4Full;
+        return (h ^ (h >> 29)) & (m_table.size() - 1);
+    }
+
+    /**
+     * Slot of the cell, or the free slot where it would go (linear probing).
+     */
+    std::size_t find(std::int64_t cx, std::int64_t cy) const
+    {
+        std::size_t mask = m_table.size() - 1;
+        for (std::size_t slot = slot_of(cx, cy); ; slot = (slot + 1) & mask)
+        {
+            const Cell &cell = m_table[slot];
+            if (cell.head == none || (cell.cx == cx && cell.cy == cy)) return slot;
+        }
+    }
+
+    const PointSet &m_ps;
+    std::vector<Cell> m_table;
+    std::vector<Node> m_nodes;
+    std::vector<std::size_t> m_used; // Slots in use, to empty the table in O(points) rather than O(size).
+    Point m_min;
+    Point m_max;
+    double m_radius = 0.5;
+    double m_cell_size = 1;
+};
+
+/**
+ * Same result as closest_pair, in expected O(n). The random order is seeded, so runs are repeatable.
+ */
+inline ClosestPairResult closest_pair_grid(const PointSet &ps)
+{
+    if (ps.size() < 2) {
+        return ps.empty() ? ClosestPairResult{} : ClosestPairResult{ps[0]};
+    }
+
+    PointSet pts = ps;
+    std::shuffle(pts.begin(), pts.end(), std::mt19937_64{pts.size()});
+
+    constexpr std::size_t prefetch_distance = 16; // Points ahead.
+    PointGrid grid(pts);
+    ClosestPairResult closest{pts[0], pts[1]};
+    auto rebuild = [&](std::size_t count) {
+        if (!grid.reset(std::sqrt(closest.squared_distance))) return false;
+        for (std::size_t j = 0; j < count; ++j)
+        {
+            if (j + prefetch_distance < count) grid.prefetch(pts[j + prefetch_distance]);
+            grid.insert(j);
+        }
+        return true;
+    };
+
+    if (closest.squared_distance == 0) return closest;
+    if (!rebuild(2)) return closest_pair(ps); // Far too close for the extent of the points: divide and conquer.
+
+    for (std::size_t i = 2, len = pts.size(); i < len; ++i)
+    {
+        if (i + prefetch_distance < len) grid.prefetch(pts[i + prefetch_distance]);
+
+        bool closer = false;
+        grid.for_each_near(pts[i], [&](std::size_t, Point q) {
+            ClosestPairResult tentative{q, pts[i]};
+            if (tentative < closest) {
+                closest = tentative;
+                closer = true;
+            }
+        });
+
+        if (!closer) {
+            grid.insert(i);
+            continue;
+        }
+        if (closest.squared_distance == 0) return closest;
+        if (!rebuild(i + 1)) return closest_pair(ps);
+    }
+    return closest;
+}
+
+/**
+ * All pairs of points of ps at most distance apart, in no particular order. O(n + pairs) with a grid of
+ * cells of that size, for points spread over a reasonable area; if the cells would be too small (eg. a
+ * distance of 0, to find duplicates), a sweep over the points sorted on x.
+ */
+inline std::vector<ClosestPairResult> pairs_within(const PointSet &ps, double distance)
+{
+    std::vector<ClosestPairResult> pairs;
+    double squared_distance = distance * distance;
+    auto check = [&](std::size_t i, std::size_t j) {
+        ClosestPairResult pair{ps[i], ps[j]};
+        if (pair.squared_distance <= squared_distance) pairs.push_back(pair);
+    };
+
+    PointGrid grid(ps);
+    if (grid.reset(distance)) {
+        for (std::size_t i = 0; i < ps.size(); ++i) grid.insert(i);
+        for (std::size_t i = 0; i < ps.size(); ++i)
+        {
+            grid.for_each_near(ps[i], [&](std::size_t j, Point) {
+                if (j > i) check(i, j);
+            });
+        }
+        return pairs;
+    }
+
+    std::vector<std::size_t> by_x(ps.size());
+    std::iota(by_x.begin(), by_x.end(), 0);
+    std::sort(by_x.begin(), by_x.end(), [&](std::size_t a, std::size_t b) { return ps[a].x < ps[b].x; });
+    for (std::size_t i = 0; i < by_x.size(); ++i)
+    {
+        for (std::size_t j = i + 1; j < by_x.size() && ps[by_x[j]].x - ps[by_x[i]].x <= distance; ++j)
+        {
+            check(by_x[i], by_x[j]);
+        }
+    }
+    return pairs;
+}
+
+/**
+ * The k closest pairs of points of ps, closest first (fewer if ps doesn't have k pairs).
+ * Finds a distance within which there are at least k pairs, doubling a first guess, then keeps the k closest.
+ */
+inline std::vector<ClosestPairResult> k_closest_pairs(const PointSet &ps, std::size_t k)
+{
+    std::size_t n = ps.size();
+    if (n < 2 || k == 0) {
+        return {};
+    }
+    k = std::min<std::size_t>(k, n * (n - 1) / 2);
+
+    // Guess for evenly spread points: k pairs closer than r when k ~ n^2 r^2 / area.
+    auto [min_x, max_x] = std::minmax_element(ps.begin(), ps.end(), [](Point a, Point b) { return a.x < b.x; });
+    auto [min_y, max_y] = std::minmax_element(ps.begin(), ps.end(), [](Point a, Point b) { return a.y < b.y; });
+    double diagonal = std::hypot(max_x->x - min_x->x, max_y->y - min_y->y);
+    double r = std::max(std::sqrt(closest_pair_grid(ps).squared_distance), diagonal * std::sqrt(double(k)) / n);
+
+    std::vector<ClosestPairResult> pairs = pairs_within(ps, r);
+    while (pairs.size() < k)
+    {
+        r *= 2;
+        pairs = pairs_within(ps, r);
+    }
+
+    std::partial_sort(pairs.begin(), pairs.begin() + k, pairs.end());
+    pairs.resize(k);
+    return pairs;
+}
+
+
+// Closest pair of a changing set of points, known after every insertion and removal:
+// - Copies of a point are one site, which keeps their ids. While a site has several, the closest distance
+//   is 0; adding or removing a copy is O(1).
+// - Sites are in the leaves of a quadtree of square cells, hashed on their level and position: cells of
+//   level 0 have side s, and each level halves it. A leaf with more than leaf_capacity sites is split, so
+//   dense parts of the plane get small cells while sparse parts keep big ones.
+// - Each site keeps its nearest neighbour among the sites in cells as big as its own or bigger, within the
+//   3x3 cells of its size around it: its local neighbour. Two sites no further apart than the smaller of
+//   their cells is wide are local neighbours of the one in that cell. So while the closest local neighbour,
+//   first in a priority queue, is no further than the smallest leaves are wide, it is the closest pair.
+// - An inserted site finds its local neighbour, and becomes that of the sites around it, in cells as small
+//   as its own or smaller, which it is closer to. The sites around a removed one which had it for local
+//   neighbour find another one. Both look at O(1) sites on each level from that of the site down, while
+//   there are cells around it: on one level, unless the site is next to a denser part of the plane. Plus
+//   O(log n) for the queue.
+// - A leaf is split when it has more than leaf_capacity sites, two of which are then closer than half its
+//   side: the closest pair stays within the new leaves. When removals leave it further apart than the
+//   smallest leaves, these are merged back into their parent, which has at most leaf_capacity sites as
+//   they are far apart. A split or merge is O(1), and there are no more merges than splits. Past level 0,
+//   the cells are rebuilt with s twice the closest distance, from closest_pair_grid, in expected O(n): s
+//   at least doubles each time.
+
+class DynamicClosestPair
+{
+public:
+    using Id = std::size_t;
+    static constexpr Id none = std::numeric_limits<Id>::max();
+
+    /**
+     * Starts with the points of ps, with ids 0, 1... in order.
+     */
+    explicit DynamicClosestPair(const PointSet &ps = {})
+    {
+        std::vector<std::pair<Point, Id>> added;
+        added.reserve(ps.size());
+        for (Point p : ps) added.push_back({p, new_id()});
+        regroup(added);
+    }
+
+    std::size_t size() const { return m_size; }
+
+    bool contains(Id id) const { return id < m_ids.size() && m_ids[id].site != none; }
+
+    Point point(Id id) const { return m_sites[m_ids[id].site].p; }
+
+    /**
+     * Adds p. Returns its id, which may be that of a removed point.
+     */
+    Id insert(Point p)
+    {
+        Id id = new_id();
+        if (!fits(p)) {
+            attach(new_site(p), id);
+            regrid();
+            return id;
+        }
+
+        Cell cell{};
+        Node &leaf = leaf_for(p, cell);
+        for (std::size_t s : leaf.sites)
+        {
+            if (m_sites[s].p.x == p.x && m_sites[s].p.y == p.y) {
+                attach(s, id);
+                return id;
+            }
+        }
+
+        std::size_t s = new_site(p);
+        attach(s, id);
+        place(s, cell, leaf);
+        if (leaf.sites.size() > leaf_capacity) {
+            split(cell);
+            announce(s, cell.level);
+        } else {
+            find_nearest(s, true);
+            announce(s, cell.level + 1);
+        }
+        settle();
+        return id;
+    }
+
+    /**
+     * Removes the point with that id.
+     */
+    void erase(Id id)
+    {
+        std::size_t s = detach(id);
+        if (m_sites[s].id != none) return;
+
+        set_nearest(s, none, std::numeric_limits<double>::infinity());
+        unplace(s);
+        for_each_watcher(m_sites[s].p, m_sites[s].cell.level, [&](std::size_t t) {
+            if (m_sites[t].nearest == s) find_nearest(t);
+        });
+        m_free_sites.push_back(s);
+        --m_site_count;
+        settle();
+    }
+
+    /**
+     * Removes the points of erased, then inserts those of inserted. Returns the ids of the inserted points.
+     * A batch of more than half the points rebuilds the cells once, rather than updating them point by point.
+     */
+    std::vector<Id> update(const PointSet &inserted, const std::vector<Id> &erased = {})
+    {
+        std::vector<Id> ids;
+        ids.reserve(inserted.size());
+        if (inserted.size() + erased.size() <= m_size / 2) {
+            for (Id id : erased) erase(id);
+            for (Point p : inserted) ids.push_back(insert(p));
+            return ids;
+        }
+
+        for (Id id : erased) detach(id);
+        std::vector<std::pair<Point, Id>> added;
+        added.reserve(inserted.size());
+        for (Point p : inserted)
+        {
+            ids.push_back(new_id());
+            added.push_back({p, ids.back()});
+        }
+        regroup(added);
+        return ids;
+    }
+
+    /**
+     * Same as closest_pair of the points.
+     */
+    ClosestPairResult closest_pair() const
+    {
+        auto [a, b] = closest_ids();
+        if (a == none) return ClosestPairResult{};
+        if (b == none) return ClosestPairResult{point(a)};
+        return ClosestPairResult{point(a), point(b)};
+    }
+
+    /**
+     * Ids of the closest pair; none for the second one if there is only one point, and for both if none.
+     */
+    std::pair<Id, Id> closest_ids() const
+    {
+        if (!m_copies.empty()) {
+            const Site &site = m_sites[m_copies.back()];
+            return {site.id, site.copies[0]};
+        }
+        if (m_queue.empty()) {
+            if (m_size == 0) return {none, none};
+            auto it = std::find_if(m_sites.begin(), m_sites.end(), [](const Site &site) { return site.id != none; });
+            return {it->id, none};
+        }
+        std::size_t s = m_queue.begin()->second;
+        return {m_sites[s].id, m_sites[m_sites[s].nearest].id};
+    }
+
+private:
+    struct Cell
+    {
+        int level;
+        std::int64_t x;
+        std::int64_t y;
+
+        bool operator ==(const Cell &c) const { return level == c.level && x == c.x && y == c.y; }
+    };
+
+    struct CellHash
+    {
+        std::size_t operator()(const Cell &c) const
+        {
+            std::uint64_t h = static_cast<std::uint64_t>(c.x) * 0x9E3779B97F4A7C15ull ^
+                              static_cast<std::uint64_t>(c.y) * 0xC2B2AE3D27D4EB4Full ^
+                              static_cast<std::uint64_t>(c.level) * 0x165667B19E3779F9ull;
+            return h ^ (h >> 29);
+        }
+    };
+
+    struct Node
+    {
+        std::vector<std::size_t> sites; // Of a leaf.
+        std::size_t children = 0;       // Of an inner node, 0 for a leaf.
+        std::size_t slot = 0;           // Of a leaf, in the leaves of its level.
+        bool leaf() const { return children == 0; }
+    };
+
+    struct Site
+    {
+        Point p;
+        Cell cell{};                  // Its leaf.
+        std::size_t slot = 0;         // In the sites of its leaf.
+        std::size_t nearest = none;   // Local neighbour.
+        double distance = std::numeric_limits<double>::infinity(); // Squared, to it.
+        Id id = none;                 // Of p; none once removed.
+        std::vector<Id> copies;       // Ids of its other copies.
+        std::size_t copy_slot = 0;    // In m_copies, if it has several ids.
+    };
+
+    struct IdEntry
+    {
+        std::size_t site = none;
+        std::size_t slot = 0; // 0 for the id of its site, else 1 + its position in the copies.
+    };
+
+    // More sites than that in a square have two closer than half its side, from the area they cover.
+    static constexpr std::size_t leaf_capacity = 16;
+    // Cells are numbered with 64-bit integers: the coordinates must be less than max_cells level 0 cells
+    // from 0, and less than max_index cells of any level.
+    static constexpr double max_cells = 1ll << 60;
+    static constexpr double max_index = 1ll << 62;
+
+    bool fits(Point p) const
+    {
+        return std::abs(p.x) / m_side < max_cells && std::abs(p.y) / m_side < max_cells;
+    }
+
+    double side(int level) const { return level == 0 ? m_side : std::ldexp(m_side, -level); }
+
+    /**
+     * The cell of that level which has p, if it can be numbered.
+     */
+    bool cell_of(Point p, int level, Cell &c) const
+    {
+        double w = side(level);
+        double x = std::floor(p.x / w);
+        double y = std::floor(p.y / w);
+        if (!(std::abs(x) < max_index && std::abs(y) < max_index)) return false;
+        c = {level, static_cast<std::int64_t>(x), static_cast<std::int64_t>(y)};
+        return true;
+    }
+
+    static std::int64_t shift(std::int64_t i, int k)
+    {
+        if (k >= 63) return i < 0 ? -1 : 0;
+        return i >= 0 ? i >> k : ~(~i >> k);
+    }
+
+    static Cell ancestor(Cell c, int level)
+    {
+        return {level, shift(c.x, c.level - level), shift(c.y, c.level - level)};
+    }
+
+    bool divisible(Cell c) const
+    {
+        return std::abs(c.x) < max_index / 2 - 1 && std::abs(c.y) < max_index / 2 - 1 &&
+               side(c.level + 1) >= std::numeric_limits<double>::min() && std::isfinite(side(c.level));
+    }
+
+    const Node *node(Cell c) const
+    {
+        auto it = m_nodes.find(c);
+        return it == m_nodes.end() ? nullptr : &it->second;
+    }
+
+    int deepest() const { return int(m_levels.size()) - 1; }
+
+    /**
+     * Adds the leaf c to those of its level; level 0 ones are never merged, so are not listed.
+     */
+    void list(Cell c, Node &leaf)
+    {
+        if (c.level == 0) return;
+        if (m_levels.size() <= std::size_t(c.level)) m_levels.resize(c.level + 1);
+        leaf.slot = m_levels[c.level].size();
+        m_levels[c.level].push_back(c);
+    }
+
+    void unlist(Cell c, const Node &leaf)
+    {
+        if (c.level == 0) return;
+        std::vector<Cell> &leaves = m_levels[c.level];
+        leaves[leaf.slot] = leaves.back();
+        m_nodes.find(leaves[leaf.slot])->second.slot = leaf.slot;
+        leaves.pop_back();
+        while (m_levels.size() > 1 && m_levels.back().empty()) m_levels.pop_back();
+    }
+
+    Node &add_leaf(Cell c)
+    {
+        Node &leaf = m_nodes.emplace(c, Node{}).first->second;
+        list(c, leaf);
+        return leaf;
+    }
+
+    /**
+     * The leaf for p, and its cell: the one which has p, or else a new one, child of the deepest inner node
+     * which has it.
+     */
+    Node &leaf_for(Point p, Cell &c)
+    {
+        cell_of(p, 0, c);
+        auto [it, added] = m_nodes.try_emplace(c);
+        if (added || it->second.leaf()) return it->second;
+
+        int lo = 0;
+        int hi = deepest();
+        while (lo < hi)
+        {
+            int mid = (lo + hi + 1) / 2;
+            Cell m{};
+            if (cell_of(p, mid, m) && node(m)) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        cell_of(p, lo, c);
+        Node &n = m_nodes.find(c)->second;
+        if (n.leaf()) return n;
+        ++n.children;
+        cell_of(p, lo + 1, c);
+        return add_leaf(c);
+    }
+
+    /**
+     * The leaf bigger than c which has it, if any, when there is no node c.
+     */
+    bool leaf_over(Cell c, Cell &leaf) const
+    {
+        if (c.level == 0 || !node(ancestor(c, 0))) return false;
+
+        int lo = 0;
+        int hi = c.level - 1;
+        while (lo < hi)
+        {
+            int mid = (lo + hi + 1) / 2;
+            if (node(ancestor(c, mid))) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        leaf = ancestor(c, lo);
+        return node(leaf)->leaf();
+    }
+
+    void place(std::size_t s, Cell c, Node &leaf)
+    {
+        m_sites[s].cell = c;
+        m_sites[s].slot = leaf.sites.size();
+        leaf.sites.push_back(s);
+    }
+
+    /**
+     * Takes the site out of its leaf, and drops the nodes left empty.
+     */
+    void unplace(std::size_t s)
+    {
+        const Site &site = m_sites[s];
+        auto it = m_nodes.find(site.cell);
+        Node &leaf = it->second;
+        leaf.sites[site.slot] = leaf.sites.back();
+        m_sites[leaf.sites[site.slot]].slot = site.slot;
+        leaf.sites.pop_back();
+        if (!leaf.sites.empty()) return;
+
+        Cell c = site.cell;
+        unlist(c, leaf);
+        m_nodes.erase(it);
+        while (c.level > 0)
+        {
+            c = ancestor(c, c.level - 1);
+            auto parent = m_nodes.find(c);
+            if (--parent->second.children > 0) break;
+            m_nodes.erase(parent);
+        }
+    }
+
+    /**
+     * Calls fn(t) for the sites t in cells as small as that level or smaller, with p in the 3x3 cells around.
+     */
+    template <class Fn>
+    void for_each_watcher(Point p, int level, Fn &&fn)
+    {
+        for (int j = level; j <= deepest(); ++j)
+        {
+            Cell c{};
+            if (!cell_of(p, j, c)) return;
+            bool any = false;
+            for (std::int64_t x = c.x - 1; x <= c.x + 1; ++x)
+            {
+                for (std::int64_t y = c.y - 1; y <= c.y + 1; ++y)
+                {
+                    auto it = m_nodes.find({j, x, y});
+                    if (it == m_nodes.end()) continue;
+                    any = true;
+                    if (!it->second.leaf()) continue;
+                    for (std::size_t t : it->second.sites) fn(t);
+                }
+            }
+            if (!any) return;
+        }
+    }
+
+    void set_nearest(std::size_t s, std::size_t nearest, double distance)
+    {
+        Site &site = m_sites[s];
+        if (site.nearest != none) m_queue.erase({site.distance, s});
+        site.nearest = nearest;
+        site.distance = distance;
+        if (nearest != none) m_queue.insert({distance, s});
+    }
+
+    /**
+     * Local neighbour of s: the nearest site in the 3x3 cells of its level around its own, in a leaf of
+     * that level or bigger. If announced, s also becomes that of the sites in the leaves of its level which
+     * it is closer to.
+     */
+    void find_nearest(std::size_t s, bool announced = false)
+    {
+        const Site &site = m_sites[s];
+        Cell c = site.cell;
+        double best = std::numeric_limits<double>::infinity();
+        std::size_t nearest = none;
+        Cell seen[9];
+        std::size_t n_seen = 0;
+        for (std::int64_t x = c.x - 1; x <= c.x + 1; ++x)
+        {
+            for (std::int64_t y = c.y - 1; y <= c.y + 1; ++y)
+            {
+                Cell leaf{c.level, x, y};
+                auto it = m_nodes.find(leaf);
+                if (it == m_nodes.end()) {
+                    // A bigger leaf may have it, and other cells around.
+                    if (!leaf_over(leaf, leaf) || std::find(seen, seen + n_seen, leaf) != seen + n_seen) continue;
+                    seen[n_seen++] = leaf;
+                    it = m_nodes.find(leaf);
+                }
+                if (!it->second.leaf()) continue;
+                for (std::size_t t : it->second.sites)
+                {
+                    Cell tc{};
+                    if (t == s || (leaf.level < c.level && (!cell_of(m_sites[t].p, c.level, tc) ||
+                                                            std::abs(tc.x - c.x) > 1 || std::abs(tc.y - c.y) > 1))) {
+                        continue;
+                    }
+                    double d = predicates::squared_distance(site.p, m_sites[t].p);
+                    if (d < best || nearest == none) best = d, nearest = t;
+                    if (announced && leaf.level == c.level && (d < m_sites[t].distance || m_sites[t].nearest == none)) {
+                        set_nearest(t, s, d);
+                    }
+                }
+            }
+        }
+        set_nearest(s, nearest, best);
+    }
+
+    /**
+     * Makes s the local neighbour of the sites around it, in cells of that level or smaller, which it is
+     * closer to than theirs.
+     */
+    void announce(std::size_t s, int level)
+    {
+        for_each_watcher(m_sites[s].p, level, [&](std::size_t t) {
+            double d = predicates::squared_distance(m_sites[s].p, m_sites[t].p);
+            if (t != s && (d < m_sites[t].distance || m_sites[t].nearest == none)) set_nearest(t, s, d);
+        });
+    }
+
+    /**
+     * Splits the leaf c, and those of the new leaves which still have too many sites. Their sites find their
+     * local neighbour again, as do the sites in bigger cells which had one of them.
+     */
+    void split(Cell c)
+    {
+        std::vector<std::size_t> moved = m_nodes.find(c)->second.sites;
+        std::vector<Cell> todo{c};
+        while (!todo.empty())
+        {
+            Cell cell = todo.back();
+            todo.pop_back();
+            Node &n = m_nodes.find(cell)->second;
+            if (n.sites.size() <= leaf_capacity || !divisible(cell)) continue;
+
+            std::vector<std::size_t> sites = std::move(n.sites);
+            n.sites.clear();
+            unlist(cell, n);
+            n.children = 0;
+            for (std::size_t s : sites)
+            {
+                Cell child{};
+                cell_of(m_sites[s].p, cell.level + 1, child);
+                auto it = m_nodes.find(child);
+                if (it == m_nodes.end()) {
+                    ++n.children;
+                    it = m_nodes.emplace(child, Node{}).first;
+                    list(child, it->second);
+                    todo.push_back(child);
+                }
+                place(s, child, it->second);
+            }
+        }
+
+        for (std::size_t s : moved) find_nearest(s);
+        for (std::size_t s : moved)
+        {
+            for_each_watcher(m_sites[s].p, c.level, [&](std::size_t t) {
+                if (m_sites[t].nearest == s && m_sites[t].cell.level < m_sites[s].cell.level) find_nearest(t);
+            });
+        }
+    }
+
+    /**
+     * Makes the inner node c, whose children are leaves, a leaf with their sites. These find their local
+     * neighbour again, and become that of the sites around them which they are closer to.
+     */
+    void merge(Cell c)
+    {
+        std::vector<std::size_t> moved;
+        for (int i = 0; i < 4; ++i)
+        {
+            auto child = m_nodes.find({c.level + 1, 2 * c.x + i % 2, 2 * c.y + i / 2});
+            if (child == m_nodes.end()) continue;
+            moved.insert(moved.end(), child->second.sites.begin(), child->second.sites.end());
+            unlist(child->first, child->second);
+            m_nodes.erase(child);
+        }
+        Node &n = m_nodes.find(c)->second;
+        n.children = 0;
+        list(c, n);
+        for (std::size_t s : moved) place(s, c, n);
+        for (std::size_t s : moved) find_nearest(s);
+        for (std::size_t s : moved) announce(s, c.level);
+    }
+
+    /**
+     * Merges the smallest leaves, or rebuilds the cells, until the closest local neighbour is no further
+     * than the smallest leaves are wide: then it is the closest pair.
+     */
+    void settle()
+    {
+        while (m_site_count >= 2)
+        {
+            double closest = m_queue.empty() ? std::numeric_limits<double>::infinity() : m_queue.begin()->first;
+            double w = side(deepest());
+            if (closest <= w * w) return;
+            if (deepest() == 0) {
+                regrid();
+                return;
+            }
+            Cell leaf = m_levels.back().back();
+            merge(ancestor(leaf, leaf.level - 1));
+        }
+    }
+
+    /**
+     * Level 0 cells of side twice the closest distance (bigger if the coordinates need it), with all the sites.
+     */
+    void regrid()
+    {
+        PointSet ps;
+        std::vector<std::size_t> sites;
+        double max_abs = 0;
+        for (std::size_t s = 0; s < m_sites.size(); ++s)
+        {
+            if (m_sites[s].id == none) continue;
+            ps.push_back(m_sites[s].p);
+            sites.push_back(s);
+            max_abs = std::max({max_abs, std::abs(m_sites[s].p.x), std::abs(m_sites[s].p.y)});
+        }
+
+        double closest = ps.size() < 2 ? 0 : std::sqrt(closest_pair_grid(ps).squared_distance);
+        m_side = std::max({2 * closest, 4 * max_abs / max_cells, std::numeric_limits<double>::min()});
+        m_nodes.clear();
+        m_nodes.reserve(sites.size());
+        m_levels.assign(1, {});
+        m_queue.clear();
+        for (std::size_t s : sites)
+        {
+            m_sites[s].nearest = none;
+            m_sites[s].distance = std::numeric_limits<double>::infinity();
+            Cell c{};
+            cell_of(m_sites[s].p, 0, c);
+            auto it = m_nodes.find(c);
+            place(s, c, it == m_nodes.end() ? add_leaf(c) : it->second);
+        }
+        for (std::size_t s : sites) find_nearest(s);
+    }
+
+    /**
+     * Makes the sites again from the ids of all the points, with those of added, then the cells.
+     */
+    void regroup(std::vector<std::pair<Point, Id>> &added)
+    {
+        for (const Site &site : m_sites)
+        {
+            if (site.id != none) added.push_back({site.p, site.id});
+            for (Id id : site.copies) added.push_back({site.p, id});
+        }
+        std::sort(added.begin(), added.end(), [](const auto &a, const auto &b) {
+            return a.first.x < b.first.x || (a.first.x == b.first.x && a.first.y < b.first.y);
+        });
+
+        m_sites.clear();
+        m_free_sites.clear();
+        m_copies.clear();
+        m_site_count = 0;
+        std::size_t s = none;
+        for (std::size_t i = 0; i < added.size(); ++i)
+        {
+            Point p = added[i].first;
+            if (i == 0 || p.x != added[i - 1].first.x || p.y != added[i - 1].first.y) s = new_site(p);
+            attach(s, added[i].second);
+        }
+        regrid();
+    }
+
+    Id new_id()
+    {
+        Id id = m_ids.size();
+        if (!m_free_ids.empty()) {
+            id = m_free_ids.back();
+            m_free_ids.pop_back();
+        } else {
+            m_ids.emplace_back();
+        }
+        ++m_size;
+        return id;
+    }
+
+    std::size_t new_site(Point p)
+    {
+        std::size_t s = m_sites.size();
+        if (!m_free_sites.empty()) {
+            s = m_free_sites.back();
+            m_free_sites.pop_back();
+        } else {
+            m_sites.emplace_back();
+        }
+        Site &site = m_sites[s];
+        site.p = p;
+        site.id = none;
+        site.copies.clear(); // Keeps its memory, for the next copies.
+        site.nearest = none;
+        site.distance = std::numeric_limits<double>::infinity();
+        ++m_site_count;
+        return s;
+    }
+
+    void attach(std::size_t s, Id id)
+    {
+        Site &site = m_sites[s];
+        if (site.id == none) {
+            site.id = id;
+            m_ids[id] = {s, 0};
+            return;
+        }
+        site.copies.push_back(id);
+        m_ids[id] = {s, site.copies.size()};
+        if (site.copies.size() == 1) {
+            site.copy_slot = m_copies.size();
+            m_copies.push_back(s);
+        }
+    }
+
+    /**
+     * Takes the id from its site, which it returns, and frees it.
+     */
+    std::size_t detach(Id id)
+    {
+        auto [s, slot] = m_ids[id];
+        Site &site = m_sites[s];
+        if (site.copies.empty()) {
+            site.id = none;
+        } else {
+            Id &moved = slot == 0 ? site.id : site.copies[slot - 1];
+            moved = site.copies.back();
+            m_ids[moved].slot = slot;
+            site.copies.pop_back();
+            if (site.copies.empty()) {
+                m_copies[site.copy_slot] = m_copies.back();
+                m_sites[m_copies[site.copy_slot]].copy_slot = site.copy_slot;
+                m_copies.pop_back();
+            }
+        }
+        m_ids[id].site = none;
+        m_free_ids.push_back(id);
+        --m_size;
+        return s;
+    }
+
+    std::vector<IdEntry> m_ids;      // By id.
+    std::vector<Id> m_free_ids;      // Of removed points, to reuse.
+    std::size_t m_size = 0;
+    std::vector<Site> m_sites;
+    std::vector<std::size_t> m_free_sites;
+    std::size_t m_site_count = 0;
+    std::vector<std::size_t> m_copies; // Sites with several ids.
+    std::unordered_map<Cell, Node, CellHash> m_nodes;
+    std::vector<std::vector<Cell>> m_levels{1}; // Leaves of each level but 0, down to the deepest one.
+    std::set<std::pair<double, std::size_t>> m_queue; // Squared distance to the local neighbour of each site which has one.
+    double m_side = 1; // Of level 0 cells.
+};
+
+} //end namespace problem4
+
+#endif //UNTITLED_LECTURE3_H
@@ -2,8 +2,14 @@
 // Created by bruno on 18/01/18.
 //
 
+#include <iostream>
+
+#include "common.h"
+#include "lecture4.h"
+
 namespace problem5 {
 
+const char description[] = R"(
 // Problem 5: Finding line segment intersections
 // Problem: Given a set of h horizontal and v vertical line segments in the plane,
 // find all intersections.
@@ -37,7 +43,69 @@ namespace problem5 {
 // - When a vertical line is encountered during the sweep, consider only the candidate lines for intersections
 // - This will result in a real speed-up in many cases, but could still have as many as hv comparisons
 
-// TODO actually create the thing
+// - Keep the candidates sorted on their y coordinate: the ones crossed by a vertical line
+//   then form a contiguous range, which is found in O(log n) and walked in O(p) (see hv_intersections).
+
+// General case: arbitrary line segments (Bentley-Ottmann, see BentleyOttmann)
+// - The candidate set now holds every segment crossed by the sweep line, ordered on the y coordinate
+//   of the crossing.
+// - Two segments can only intersect after having been neighbours in the candidate set, so only
+//   neighbours are tested (with intersect() from problem 1).
+// - The crossing points of neighbours are added to the list of endpoints as they are found. When the
+//   sweep reaches one, the segments through it swap their order and get new neighbours.
+// - Segments lying on the same line only meet at an endpoint of one of them, so the special case
+//   of problem 1 is caught when that endpoint is processed.
+)";
+
+const char analysis[] = R"(
+// Analysis of the algorithm:
+// - Sorting the 2h + v endpoints is O(n log n)
+// - Each horizontal line is inserted and removed from the candidate set once: O(log n) each
+// - Each vertical line costs O(log n) to locate its range, plus O(1) per reported intersection
+
+// Hence overall O(n log n + p).
+
+// For arbitrary segments, each of the 2n endpoints and k crossings costs O(log n) in the event list
+// and the candidate set, plus O(1) per reported pair: O((n + k) log n).
+)";
+
+void run(bool verbose)
+{
+    std::vector<Line> hs, vs;
+    for (Line l : ask_lineset())
+    {
+        if (l.p1.y == l.p2.y) {
+            hs.push_back(l);
+        } else if (l.p1.x == l.p2.x) {
+            vs.push_back(l);
+        } else {
+            std::cout << "ignoring segment " << l << " (neither horizontal nor vertical)." << std::endl;
+        }
+    }
+
+    std::size_t count = 0;
+    auto us = time_us([&] {
+        hv_intersections(hs, vs, [&](std::size_t i, std::size_t j) {
+            ++count;
+            if (verbose) std::cout << hs[i] << " intersects " << vs[j] << std::endl;
+        });
+    });
+    std::cout << count << " intersections found (" << us.count() << " us)" << std::endl;
+}
+
+void run_general(bool verbose)
+{
+    std::vector<Line> ls = ask_lineset();
+
+    std::size_t count = 0;
+    auto us = time_us([&] {
+        all_intersections(ls, [&](std::size_t i, std::size_t j) {
+            ++count;
+            if (verbose) std::cout << ls[i] << " intersects " << ls[j] << std::endl;
+        });
+    });
+    std::cout << count << " intersections found (" << us.count() << " us)" << std::endl;
+}
 
 
 } // end namespace problem5
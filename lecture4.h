@@ -0,0 +1,384 @@
+//
+// Created by bruno on 18/01/18.
+//
+
+#ifndef UNTITLED_LECTURE4_H
+#define UNTITLED_LECTURE4_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+#include "lecture1.h"
+
+namespace problem5 {
+
+/**
+ * Line-sweep over h horizontal (hs) and v vertical (vs) segments.
+ * Calls report(h_index, v_index) for every intersecting pair, as soon as it is found, so the
+ * intersections are streamed out rather than stored. O(n log n + p) with n = h + v.
+ * Touching endpoints count as an intersection, as in intersect() (problem 1).
+ */
+template <class Fn>
+void hv_intersections(const std::vector<Line> &hs, const std::vector<Line> &vs, Fn &&report)
+{
+    // At the same x, a horizontal must enter the candidate set before verticals are checked,
+    // and leave it only afterwards.
+    enum Kind { h_start, vertical, h_end };
+
+    struct Event
+    {
+        double x;
+        Kind kind;
+        std::size_t idx;
+    };
+
+    std::vector<Event> events;
+    events.reserve(2 * hs.size() + vs.size());
+
+    for (std::size_t i = 0, len = hs.size(); i < len; ++i)
+    {
+        auto [left, right] = std::minmax(hs[i].p1.x, hs[i].p2.x);
+        events.push_back({left, h_start, i});
+        events.push_back({right, h_end, i});
+    }
+    for (std::size_t j = 0, len = vs.size(); j < len; ++j)
+    {
+        events.push_back({vs[j].p1.x, vertical, j});
+    }
+
+    std::sort(events.begin(), events.end(), [](const Event &e1, const Event &e2) {
+        return e1.x < e2.x || (e1.x == e2.x && e1.kind < e2.kind);
+    });
+
+    // Candidate horizontals, keyed on their y-coord, so that the ones crossing a vertical
+    // are a contiguous range.
+    using ActiveSet = std::multimap<double, std::size_t>;
+    ActiveSet active;
+    std::vector<ActiveSet::iterator> handles(hs.size());
+
+    for (const Event &e : events)
+    {
+        switch (e.kind)
+        {
+        case h_start:
+            handles[e.idx] = active.emplace(hs[e.idx].p1.y, e.idx);
+            break;
+        case h_end:
+            active.erase(handles[e.idx]);
+            break;
+        case vertical:
+        {
+            auto [bottom, top] = std::minmax(vs[e.idx].p1.y, vs[e.idx].p2.y);
+            for (auto it = active.lower_bound(bottom), end = active.upper_bound(top); it != end; ++it)
+            {
+                report(it->second, e.idx);
+            }
+            break;
+        }
+        }
+    }
+}
+
+/**
+ * Bentley-Ottmann sweep over arbitrary segments.
+ * Calls report(i, j) (with i < j) exactly once for every pair of segments for which
+ * intersect(ls[i], ls[j]) holds. O((n + k) log n) for k intersecting pairs.
+ */
+class BentleyOttmann
+{
+public:
+    explicit BentleyOttmann(const std::vector<Line> &ls)
+        : m_lines(ls), m_segs(ls), m_status(StatusOrder{this}), m_handles(ls.size()),
+          m_in_status(ls.size(), 0), m_at_event(ls.size(), 0), m_rank(ls.size(), 0)
+    {
+        for (std::size_t s = 0, len = m_segs.size(); s < len; ++s)
+        {
+            // Orient each segment so that it starts at the endpoint the sweep meets first.
+            Line &l = m_segs[s];
+            if (key(l.p2) < key(l.p1)) std::swap(l.p1, l.p2);
+
+            m_events[key(l.p1)].upper.push_back(s);
+            m_events[key(l.p2)].lower.push_back(s);
+        }
+    }
+
+    template <class Fn>
+    void run(Fn &&report)
+    {
+        while (!m_events.empty())
+        {
+            auto node = m_events.extract(m_events.begin());
+            m_sweep = {node.key().first, node.key().second};
+            handle_event(node.mapped(), report);
+        }
+    }
+
+private:
+    // Event points are visited by increasing x, then increasing y.
+    using Key = std::pair<double, double>;
+
+    struct Event
+    {
+        std::vector<std::size_t> upper;   // segments starting here
+        std::vector<std::size_t> lower;   // segments ending here
+        std::vector<std::size_t> through; // segments found to cross each other here
+    };
+
+    // Orders the segments crossed by the sweep line from bottom to top.
+    struct StatusOrder
+    {
+        using is_transparent = void;
+
+        const BentleyOttmann *bo;
+
+        bool operator()(std::size_t a, std::size_t b) const { return bo->below(a, b); }
+        bool operator()(std::size_t a, double y) const     { return bo->y_at(a) < y; }
+        bool operator()(double y, std::size_t a) const     { return y < bo->y_at(a); }
+    };
+
+    using Status = std::set<std::size_t, StatusOrder>;
+
+    static Key key(Point p) { return {p.x, p.y}; }
+
+    static double cross(Vec2d u, Vec2d v) { return u.x * v.y - u.y * v.x; }
+
+    Vec2d dir(std::size_t s) const { return m_segs[s].p2 - m_segs[s].p1; }
+
+    /**
+     * y-coord of segment s where it meets the sweep line.
+     */
+    double y_at(std::size_t s) const
+    {
+        const Line &l = m_segs[s];
+        if (m_at_event[s]) return m_sweep.y;
+        if (l.p1.x == l.p2.x) return std::clamp(m_sweep.y, l.p1.y, l.p2.y);
+
+        double t = (m_sweep.x - l.p1.x) / (l.p2.x - l.p1.x);
+        return l.p1.y + t * (l.p2.y - l.p1.y);
+    }
+
+    /**
+     * Whether a is below b just after the sweep point. Segments meeting at the sweep point are
+     * ordered on their slope (vertical segments last).
+     */
+    bool below(std::size_t a, std::size_t b) const
+    {
+        double ya = y_at(a);
+        double yb = y_at(b);
+        if (ya != yb) return ya < yb;
+
+        double turn = cross(dir(a), dir(b));
+        if (turn != 0) return turn > 0;
+
+        return a < b;
+    }
+
+    /**
+     * Whether segment s passes through the sweep point. Crossings are computed in floating point,
+     * so allow for the few ulps of error the computed point carries.
+     */
+    bool contains_sweep(std::size_t s) const
+    {
+        const Line &l = m_segs[s];
+        Vec2d d = dir(s);
+        Vec2d w = m_sweep - l.p1;
+        double tolerance = 64 * std::numeric_limits<double>::epsilon() *
+                           (std::abs(d.x) + std::abs(d.y)) * (std::abs(w.x) + std::abs(w.y));
+
+        auto [min_y, max_y] = std::minmax(l.p1.y, l.p2.y);
+        return std::abs(cross(d, w)) <= tolerance &&
+               l.p1.x <= m_sweep.x && m_sweep.x <= l.p2.x &&
+               min_y <= m_sweep.y && m_sweep.y <= max_y;
+    }
+
+    bool collinear(std::size_t a, std::size_t b) const
+    {
+        return cross(dir(a), dir(b)) == 0 && cross(dir(a), m_segs[b].p1 - m_segs[a].p1) == 0;
+    }
+
+    /**
+     * Whether the sweep point is the first one shared by a and b, which both pass through it.
+     * Collinear overlapping pairs meet where the overlap starts. Crossing pairs already ordered on
+     * their slope were handled at an earlier event, which rounding placed at nearly the same point.
+     */
+    bool first_meeting(std::size_t a, std::size_t b) const
+    {
+        if (collinear(a, b)) {
+            return key(m_segs[a].p1) == key(m_sweep) || key(m_segs[b].p1) == key(m_sweep);
+        }
+        if (m_rank[a] == 0 || m_rank[b] == 0) return true;
+
+        if (m_rank[b] < m_rank[a]) std::swap(a, b);
+        return cross(dir(a), dir(b)) < 0;
+    }
+
+    /**
+     * a and b are neighbours in the status, a below b. Schedule their crossing if it is still ahead.
+     */
+    void check(std::size_t a, std::size_t b)
+    {
+        // Past the sweep line, a can only meet b if it rises faster. Collinear overlaps always
+        // start at an endpoint, so they are found there.
+        double turn = cross(dir(a), dir(b));
+        if (turn >= 0 || !intersect(m_segs[a], m_segs[b])) return;
+
+        double t = cross(m_segs[b].p1 - m_segs[a].p1, dir(b)) / turn;
+        Point q{m_segs[a].p1.x + t * dir(a).x, m_segs[a].p1.y + t * dir(a).y};
+
+        // Don't let rounding move the crossing behind the sweep line.
+        if (key(q) < key(m_sweep)) q = m_sweep;
+
+        auto &through = m_events[key(q)].through;
+        through.push_back(a);
+        through.push_back(b);
+    }
+
+    template <class Fn>
+    void handle_event(const Event &e, Fn &report)
+    {
+        // Segments ending or crossing at the sweep point: the ones recorded on the event, plus
+        // those of the status which pass through it (eg. when another segment starts on them).
+        std::vector<std::size_t> &meeting = m_meeting;
+        meeting.clear();
+        meeting.insert(meeting.end(), e.lower.begin(), e.lower.end());
+        for (std::size_t s : e.through)
+        {
+            if (m_in_status[s]) meeting.push_back(s);
+        }
+        for (std::size_t s : meeting) m_at_event[s] = 1;
+
+        auto found = m_status.lower_bound(m_sweep.y);
+        if (found != m_status.end() && !m_at_event[*found] && contains_sweep(*found)) {
+            meeting.push_back(*found);
+            m_at_event[*found] = 1;
+        }
+
+        // The segments through the sweep point are contiguous in the status: grow the group
+        // until its neighbours neither pass through the point nor overlap one of its members.
+        for (std::size_t i = 0; i < meeting.size(); ++i)
+        {
+            std::size_t s = meeting[i];
+            if (!m_in_status[s]) continue;
+
+            auto it = m_handles[s];
+            auto joins = [&](std::size_t t) {
+                return !m_at_event[t] && (contains_sweep(t) || collinear(s, t));
+            };
+            if (it != m_status.begin() && joins(*std::prev(it))) {
+                meeting.push_back(*std::prev(it));
+                m_at_event[meeting.back()] = 1;
+            }
+            if (std::next(it) != m_status.end() && joins(*std::next(it))) {
+                meeting.push_back(*std::next(it));
+                m_at_event[meeting.back()] = 1;
+            }
+        }
+
+        // Remember the order in which the segments reached the sweep point: the crossings
+        // happening here are the pairs which are not yet ordered on their slope.
+        std::size_t rank = 0;
+        for (std::size_t s : meeting)
+        {
+            auto it = m_handles[s];
+            if (!m_in_status[s] || (it != m_status.begin() && m_at_event[*std::prev(it)])) continue;
+
+            for (; it != m_status.end() && m_at_event[*it]; ++it)
+            {
+                m_rank[*it] = ++rank;
+            }
+        }
+
+        for (std::size_t s : meeting)
+        {
+            if (m_in_status[s]) {
+                m_status.erase(m_handles[s]);
+                m_in_status[s] = 0;
+            }
+        }
+
+        meeting.insert(meeting.end(), e.upper.begin(), e.upper.end());
+        std::sort(meeting.begin(), meeting.end());
+        meeting.erase(std::unique(meeting.begin(), meeting.end()), meeting.end());
+        for (std::size_t s : meeting) m_at_event[s] = 1;
+
+        // Every pair meeting here intersects, but is reported only at the first point it shares.
+        for (std::size_t i = 0, len = meeting.size(); i < len; ++i)
+        {
+            for (std::size_t j = i + 1; j < len; ++j)
+            {
+                if (first_meeting(meeting[i], meeting[j]) && intersect(m_lines[meeting[i]], m_lines[meeting[j]])) {
+                    report(meeting[i], meeting[j]);
+                }
+            }
+        }
+
+        // Re-insert the segments continuing past the sweep point, now ordered as they leave it.
+        std::size_t lowest = m_lines.size();
+        std::size_t highest = m_lines.size();
+        for (std::size_t s : meeting)
+        {
+            if (key(m_segs[s].p2) == key(m_sweep)) continue;
+
+            m_handles[s] = m_status.insert(s).first;
+            m_in_status[s] = 1;
+
+            if (lowest == m_lines.size() || below(s, lowest)) lowest = s;
+            if (highest == m_lines.size() || below(highest, s)) highest = s;
+        }
+
+        if (lowest == m_lines.size()) {
+            auto above = m_status.lower_bound(m_sweep.y);
+            if (above != m_status.begin() && above != m_status.end()) {
+                check(*std::prev(above), *above);
+            }
+        } else {
+            auto lo = m_handles[lowest];
+            auto hi = std::next(m_handles[highest]);
+            if (lo != m_status.begin()) check(*std::prev(lo), lowest);
+            if (hi != m_status.end()) check(highest, *hi);
+        }
+
+        for (std::size_t s : meeting)
+        {
+            m_at_event[s] = 0;
+            m_rank[s] = 0;
+        }
+    }
+
+    const std::vector<Line> &m_lines;
+    std::vector<Line> m_segs;
+    std::map<Key, Event> m_events;
+    Status m_status;
+    std::vector<Status::iterator> m_handles;
+    std::vector<char> m_in_status;
+    std::vector<char> m_at_event;
+    std::vector<std::size_t> m_rank;
+    std::vector<std::size_t> m_meeting;
+    Point m_sweep;
+};
+
+/**
+ * Reports every intersecting pair of segments in ls through report(i, j). See BentleyOttmann.
+ */
+template <class Fn>
+void all_intersections(const std::vector<Line> &ls, Fn &&report)
+{
+    BentleyOttmann(ls).run(report);
+}
+
+extern const char description[];
+extern const char analysis[];
+
+void run(bool verbose);
+
+void run_general(bool verbose);
+
+} // end namespace problem5
+
+#endif //UNTITLED_LECTURE4_H
@@ -0,0 +1,267 @@
+//
+// Created by bruno on 20/01/18.
+//
+
+#ifndef UNTITLED_PARALLEL_H
+#define UNTITLED_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Number of threads to use when the caller doesn't say.
+ */
+inline unsigned hardware_threads()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/**
+ * Calls fn(i) for every i in [0, n), spread over (at most) the given number of threads.
+ * Indices are handed out one at a time, so uneven tasks still keep every thread busy.
+ */
+template <class Fn>
+void parallel_for(std::size_t n, Fn &&fn, unsigned threads = hardware_threads())
+{
+    std::atomic<std::size_t> next{0};
+    auto work = [&] {
+        for (std::size_t i = next++; i < n; i = next++)
+        {
+            fn(i);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (std::size_t t = 1, len = std::min<std::size_t>(threads, n); t < len; ++t)
+    {
+        workers.emplace_back(work);
+    }
+    work();
+
+    for (std::thread &w : workers)
+    {
+        w.join();
+    }
+}
+
+/**
+ * Stable LSD radix sort of items on key(item), an unsigned 64-bit integer, 16 bits per pass.
+ * Each pass counts the digits of each chunk of items in parallel, in their current order; then moves every
+ * chunk to its place in parallel. Passes where all the items have the same digit are skipped.
+ * Few items are left to std::stable_sort, cheaper than going through the counts.
+ */
+template <class T, class Key>
+void radix_sort(std::vector<T> &items, Key &&key, unsigned threads = hardware_threads())
+{
+    constexpr unsigned bits = 16;
+    constexpr unsigned passes = (64 + bits - 1) / bits;
+    constexpr std::size_t buckets = std::size_t(1) << bits;
+
+    std::size_t n = items.size();
+    if (n < (1 << 12)) {
+        std::stable_sort(items.begin(), items.end(), [&](const T &a, const T &b) { return key(a) < key(b); });
+        return;
+    }
+
+    std::size_t chunks = n < (1 << 18) ? 1 : std::max(1u, threads);
+    std::size_t chunk_size = (n + chunks - 1) / chunks;
+    auto digit = [&](const T &item, unsigned pass) { return (key(item) >> (pass * bits)) & (buckets - 1); };
+
+    // offsets[c * buckets + d]: items of chunk c with digit d in the current pass, then where they go.
+    // The chunks are counted again on each pass, as the previous one has moved the items between them.
+    std::vector<std::size_t> offsets(chunks * buckets);
+    std::vector<T> buffer(n);
+    for (unsigned pass = 0; pass < passes; ++pass)
+    {
+        std::fill(offsets.begin(), offsets.end(), 0);
+        parallel_for(chunks, [&](std::size_t c) {
+            std::size_t *count = offsets.data() + c * buckets;
+            for (std::size_t i = c * chunk_size, end = std::min(n, i + chunk_size); i < end; ++i)
+            {
+                ++count[digit(items[i], pass)];
+            }
+        }, threads);
+
+        // Exclusive prefix sum, digit by digit and chunk by chunk within a digit: stable.
+        std::size_t total = 0;
+        bool skip = false;
+        for (std::size_t d = 0; d < buckets; ++d)
+        {
+            std::size_t in_digit = 0;
+            for (std::size_t c = 0; c < chunks; ++c)
+            {
+                std::size_t count = offsets[c * buckets + d];
+                offsets[c * buckets + d] = total;
+                total += count;
+                in_digit += count;
+            }
+            skip = skip || in_digit == n;
+        }
+        if (skip) continue;
+
+        parallel_for(chunks, [&](std::size_t c) {
+            std::size_t *offset = offsets.data() + c * buckets;
+            for (std::size_t i = c * chunk_size, end = std::min(n, i + chunk_size); i < end; ++i)
+            {
+                buffer[offset[digit(items[i], pass)]++] = items[i];
+            }
+        }, threads);
+        items.swap(buffer);
+    }
+}
+
+/**
+ * Pool of threads for fork-join parallelism (divide and conquer).
+ * Each thread has a queue of forked tasks: it takes the latest one from its own queue, and steals the oldest
+ * one (likely the biggest) from the others when its own is empty. A thread waiting on a join runs tasks
+ * meanwhile, so nested fork_join calls never block the pool. The caller of fork_join counts as a thread.
+ */
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(unsigned threads = hardware_threads()) : m_queues(std::max(1u, threads))
+    {
+        for (Queue &q : m_queues) q.tasks.reserve(64);
+        for (unsigned i = 1; i < m_queues.size(); ++i)
+        {
+            m_workers.emplace_back([this, i] { work(i); });
+        }
+    }
+
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (std::thread &w : m_workers)
+        {
+            w.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(m_queues.size()); }
+
+    /**
+     * Runs a() and b(), possibly in parallel, and returns once both are done. Doesn't allocate.
+     */
+    template <class A, class B>
+    void fork_join(A &&a, B &&b)
+    {
+        using BFn = std::remove_reference_t<B>;
+        Task task{[](void *fn) { (*static_cast<BFn *>(fn))(); }, const_cast<void *>(static_cast<const void *>(&b))};
+        unsigned q = queue_index();
+        push(q, &task);
+        a();
+
+        while (!task.done.load(std::memory_order_acquire))
+        {
+            if (Task *t = take(q)) {
+                run(t);
+            } else {
+                std::this_thread::yield(); // b is running on another thread.
+            }
+        }
+    }
+
+private:
+    struct Task
+    {
+        void (*fn)(void *);
+        void *arg;
+        std::atomic<bool> done{false};
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::vector<Task *> tasks;
+    };
+
+    // Threads of other pools, and the callers, share the first queue.
+    static thread_local const WorkStealingPool *t_pool;
+    static thread_local unsigned t_queue;
+
+    unsigned queue_index() const { return t_pool == this ? t_queue : 0; }
+
+    void push(unsigned q, Task *task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_queues[q].mutex);
+            m_queues[q].tasks.push_back(task);
+        }
+        m_pending.fetch_add(1, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex); // No worker misses the wake-up between its check and wait.
+        }
+        m_wake.notify_one();
+    }
+
+    /**
+     * The latest task of queue q, or else the oldest task of another queue; nullptr if there are none.
+     */
+    Task *take(unsigned q)
+    {
+        for (std::size_t i = 0, len = m_queues.size(); i < len; ++i)
+        {
+            Queue &queue = m_queues[(q + i) % len];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) continue;
+
+            Task *task;
+            if (i == 0) {
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+            } else {
+                task = queue.tasks.front();
+                queue.tasks.erase(queue.tasks.begin());
+            }
+            m_pending.fetch_sub(1, std::memory_order_relaxed);
+            return task;
+        }
+        return nullptr;
+    }
+
+    static void run(Task *task)
+    {
+        task->fn(task->arg);
+        task->done.store(true, std::memory_order_release);
+    }
+
+    void work(unsigned q)
+    {
+        t_pool = this;
+        t_queue = q;
+        while (true)
+        {
+            if (Task *t = take(q)) {
+                run(t);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stop || m_pending.load(std::memory_order_acquire) > 0; });
+            if (m_stop) return;
+        }
+    }
+
+    std::vector<Queue> m_queues;
+    std::vector<std::thread> m_workers;
+    std::atomic<std::size_t> m_pending{0};
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+};
+
+inline thread_local const WorkStealingPool *WorkStealingPool::t_pool = nullptr;
+inline thread_local unsigned WorkStealingPool::t_queue = 0;
+
+#endif //UNTITLED_PARALLEL_H
@@ -0,0 +1,522 @@
+//
+// Created by bruno on 26/01/18.
+//
+
+#ifndef UNTITLED_POINT_LOCATION_H
+#define UNTITLED_POINT_LOCATION_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+#include "lecture2.h"
+#include "parallel.h"
+#include "predicates.h"
+
+// Point location in a fixed simple polygon: whether query points are inside it, outside or on its boundary,
+// in O(log n) each after preprocessing (expected, for polygons which aren't fans), instead of a ray cast over
+// all the edges.
+// - Fans: the polygons of simple_polygon_v3/v4/exact are sorted on the angle around their first point, the
+//   pivot, and so are the hulls of graham_scan. Such a polygon is a fan of triangles from the pivot, one
+//   for each angle between two consecutive rays through the vertices: a binary search on orientations
+//   finds the triangle of a query, and one more orientation test locates it. O(n) space, nothing to build.
+//   Several vertices on the same ray go out along it (back in, for the last ray).
+// - Any other simple polygon gets a trapezoidal map: walls up and down from every vertex, as far as the
+//   edges above and below it, cut the plane into trapezoids, each one between an edge above and an edge
+//   below. The edges are added in random order, each one splitting the trapezoids it crosses, and a search
+//   DAG of tests (left or right of a vertex, above or below an edge) grows with the map. A query goes down
+//   it to its trapezoid: inside if the polygon is below the edge above it. Expected O(n) space, O(n log n) to
+//   build and O(log n) per query, whatever the polygon. Points with the same x-coord are ordered on y, as
+//   if the plane were sheared a little: no two vertices share a wall, and vertical edges aren't special.
+// - Both tests are exact (see predicates.h). Polygons found to be fans, checked in O(n), use the first.
+// - Batched queries are sorted with radix_sort on their angle around the pivot (fans) or their x-coord
+//   (trapezoids), and taken in blocks over the threads: consecutive queries walk the same part of the index.
+
+enum class Location
+{
+    outside,
+    inside,
+    boundary,
+};
+
+class PolygonIndex
+{
+public:
+    /**
+     * Index of the simple polygon whose vertices are polygon, in order (either way round).
+     */
+    explicit PolygonIndex(const PointSet &polygon) : m_polygon(polygon)
+    {
+        if (!build_fan()) build_map();
+    }
+
+    /**
+     * Whether queries go through the fan from the pivot (rather than the trapezoidal map).
+     */
+    bool is_fan() const { return !m_rays.empty(); }
+
+    Location locate(Point q) const
+    {
+        return is_fan() ? locate_fan(q) : locate_map(q);
+    }
+
+    bool contains(Point q) const { return locate(q) != Location::outside; }
+
+    /**
+     * locate for each query, in the order of the queries.
+     */
+    std::vector<Location> locate(const PointSet &queries, unsigned threads = hardware_threads()) const
+    {
+        std::vector<Location> res(queries.size());
+        for_each_block(queries, threads, [&](const std::size_t *order, std::size_t count) {
+            for (std::size_t i = 0; i < count; ++i) res[order[i]] = locate(queries[order[i]]);
+        });
+        return res;
+    }
+
+private:
+    // Queries per task of the batched queries.
+    static constexpr std::size_t block_size = 1024;
+
+    static constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+    /**
+     * Vertices on one ray from the pivot: the polygon goes from entry to exit along it.
+     */
+    struct Ray
+    {
+        Point entry;
+        Point exit;
+    };
+
+    /**
+     * Edge of the map, p before q in order of x then y. The polygon is on its left (above it) or on its right.
+     */
+    struct Segment
+    {
+        Point p;
+        Point q;
+        bool inside_above;
+    };
+
+    /**
+     * Trapezoid of the map, between walls through left and right, and segments top and bottom (or none).
+     * Its neighbours across each wall: above and below the point the wall goes through, or none.
+     */
+    struct Trapezoid
+    {
+        Point left;
+        Point right;
+        std::size_t top;
+        std::size_t bottom;
+        std::size_t upper_left = none;
+        std::size_t lower_left = none;
+        std::size_t upper_right = none;
+        std::size_t lower_right = none;
+        std::size_t leaf = none; // Its node in the DAG.
+    };
+
+    /**
+     * Node of the search DAG: a test on point a (left of it, or right), a test on segment a b (below it, or
+     * above), or a trapezoid. One cache line.
+     */
+    struct Node
+    {
+        enum Kind { point, segment, trapezoid } kind;
+        Point a;
+        Point b;
+        std::size_t index; // Of the trapezoid while building, of its top segment (or none) once built.
+        std::size_t left = none; // Or below.
+        std::size_t right = none; // Or above.
+    };
+
+    static bool same(Point a, Point b) { return a.x == b.x && a.y == b.y; }
+
+    static bool xy_less(Point a, Point b) { return a.x < b.x || (a.x == b.x && a.y < b.y); }
+
+    /**
+     * Whether p, on a ray through the pivot, is strictly closer to the pivot than q on the same ray.
+     * The rays all go left of the pivot, or straight up.
+     */
+    bool closer(Point p, Point q, const Ray &ray) const
+    {
+        return ray.exit.x < m_pivot.x ? p.x > q.x : p.y < q.y;
+    }
+
+    /**
+     * Whether q is in the half-plane of the other vertices of a fan: left of the pivot, or straight above it.
+     */
+    bool in_fan_half_plane(Point q) const
+    {
+        return q.x < m_pivot.x || (q.x == m_pivot.x && q.y > m_pivot.y);
+    }
+
+    /**
+     * Takes the polygon as a fan if it is one: its first point the pivot (as simple_polygon_v3 chooses it),
+     * the others in order of angle around it, and farther and farther along a ray but for the last ray.
+     */
+    bool build_fan()
+    {
+        const PointSet &ps = m_polygon;
+        if (ps.size() < 3) return false;
+
+        m_pivot = ps[0];
+        for (std::size_t i = 1; i < ps.size(); ++i)
+        {
+            if (!in_fan_half_plane(ps[i])) return false;
+            if (i > 1 && predicates::orient2d(m_pivot, ps[i - 1], ps[i]) < 0) return false;
+        }
+
+        for (std::size_t i = 1; i < ps.size(); ++i)
+        {
+            if (m_rays.empty() || predicates::orient2d(m_pivot, m_rays.back().exit, ps[i]) != 0) {
+                m_rays.push_back({ps[i], ps[i]});
+            } else {
+                m_rays.back().exit = ps[i];
+            }
+        }
+
+        // Only the last ray comes back towards the pivot; and the polygon must have some area.
+        bool valid = m_rays.size() > 1;
+        for (std::size_t i = 2, k = 0; valid && i < ps.size(); ++i)
+        {
+            if (predicates::orient2d(m_pivot, ps[i - 1], ps[i]) != 0) {
+                ++k;
+                continue;
+            }
+            bool last = k + 1 == m_rays.size();
+            valid = last ? closer(ps[i], ps[i - 1], m_rays[k]) : closer(ps[i - 1], ps[i], m_rays[k]);
+        }
+        if (!valid) m_rays.clear();
+        return valid;
+    }
+
+    Location locate_fan(Point q) const
+    {
+        if (same(q, m_pivot)) return Location::boundary;
+        if (!in_fan_half_plane(q)) return Location::outside;
+        if (predicates::orient2d(m_pivot, m_rays.front().exit, q) < 0) return Location::outside;
+
+        // Last ray at an angle up to that of q.
+        std::size_t k = std::partition_point(m_rays.begin() + 1, m_rays.end(), [&](const Ray &ray) {
+            return predicates::orient2d(m_pivot, ray.exit, q) >= 0;
+        }) - m_rays.begin() - 1;
+        const Ray &ray = m_rays[k];
+        bool last = k + 1 == m_rays.size();
+
+        double turn = predicates::orient2d(m_pivot, ray.exit, q);
+        if (turn == 0) {
+            // On the ray: inside up to where the polygon comes to the ray, then along it.
+            // The first and the last rays are edges from the pivot.
+            Point farthest = last ? ray.entry : ray.exit;
+            if (closer(farthest, q, ray)) return Location::outside;
+            if (k > 0 && !last && closer(q, ray.entry, ray)) return Location::inside;
+            return Location::boundary;
+        }
+        if (last) return Location::outside;
+
+        // Between two rays: in the triangle from the pivot to the edge across.
+        double side = predicates::orient2d(ray.exit, m_rays[k + 1].entry, q);
+        return side > 0 ? Location::inside : side == 0 ? Location::boundary : Location::outside;
+    }
+
+    bool above(const Segment &s, Point p) const { return predicates::orient2d(s.p, s.q, p) > 0; }
+
+    std::size_t add_trapezoid(Point left, Point right, std::size_t top, std::size_t bottom)
+    {
+        m_trapezoids.push_back({left, right, top, bottom});
+        m_trapezoids.back().leaf = m_nodes.size();
+        m_nodes.push_back({Node::trapezoid, Point{}, Point{}, m_trapezoids.size() - 1});
+        return m_trapezoids.size() - 1;
+    }
+
+    std::size_t add_node(Node node)
+    {
+        m_nodes.push_back(node);
+        return m_nodes.size() - 1;
+    }
+
+    /**
+     * Points whichever of the neighbours of t were at from to to.
+     */
+    void relink(std::size_t t, std::size_t from, std::size_t to)
+    {
+        if (t == none) return;
+        for (std::size_t *n : {&m_trapezoids[t].upper_left, &m_trapezoids[t].lower_left, &m_trapezoids[t].upper_right,
+                               &m_trapezoids[t].lower_right})
+        {
+            if (*n == from) *n = to;
+        }
+    }
+
+    void build_map()
+    {
+        // Without copies of a vertex in a row. On its way round, the polygon turns left at its first vertex
+        // in order of x then y if it is counter-clockwise.
+        PointSet ps;
+        for (Point p : m_polygon)
+        {
+            if (ps.empty() || !same(ps.back(), p)) ps.push_back(p);
+        }
+        while (ps.size() > 1 && same(ps.front(), ps.back())) ps.pop_back();
+        std::size_t n = ps.size();
+        std::size_t first = n ? std::min_element(ps.begin(), ps.end(), xy_less) - ps.begin() : 0;
+        Point last = n ? *std::max_element(ps.begin(), ps.end(), xy_less) : Point{};
+        bool flat = std::all_of(ps.begin(), ps.end(), [&](Point p) { return predicates::orient2d(ps[first], last, p) == 0; });
+        if (n == 0) {
+            // Nothing: outside everywhere.
+        } else if (flat) {
+            // No inside: the boundary is the segment between the extreme vertices, or a lone vertex.
+            if (same(ps[first], last)) m_nodes.push_back({Node::point, last, last, 0, 1, 1});
+            else m_segments.push_back({ps[first], last, false});
+        } else {
+            double turn = predicates::orient2d(ps[(first + n - 1) % n], ps[first], ps[(first + 1) % n]);
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                Point a = ps[i], b = ps[(i + 1) % n];
+                bool forward = xy_less(a, b);
+                m_segments.push_back({forward ? a : b, forward ? b : a, forward == (turn > 0)});
+            }
+        }
+
+        double inf = std::numeric_limits<double>::infinity();
+        add_trapezoid({-inf, -inf}, {inf, inf}, none, none);
+        std::vector<std::size_t> order(m_segments.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), std::mt19937(order.size()));
+        for (std::size_t s : order) add_segment(s);
+        lay_out();
+    }
+
+    /**
+     * Puts the nodes in depth-first order, for queries to go through fewer cache lines, and the top segment
+     * in the trapezoids; the trapezoids themselves are no longer needed.
+     */
+    void lay_out()
+    {
+        std::vector<std::size_t> position(m_nodes.size(), none);
+        std::vector<Node> nodes;
+        nodes.reserve(m_nodes.size());
+        std::vector<std::size_t> stack{0};
+        while (!stack.empty())
+        {
+            std::size_t node = stack.back();
+            stack.pop_back();
+            if (position[node] != none) continue;
+            position[node] = nodes.size();
+            nodes.push_back(m_nodes[node]);
+            if (m_nodes[node].kind == Node::trapezoid) {
+                nodes.back().index = m_trapezoids[m_nodes[node].index].top;
+            } else {
+                stack.push_back(m_nodes[node].right);
+                stack.push_back(m_nodes[node].left);
+            }
+        }
+        for (Node &node : nodes)
+        {
+            if (node.kind == Node::trapezoid) continue;
+            node.left = position[node.left];
+            node.right = position[node.right];
+        }
+        m_nodes = std::move(nodes);
+        m_trapezoids = {};
+    }
+
+    /**
+     * Trapezoid where segment s starts, just right of its first point.
+     */
+    std::size_t find_start(const Segment &s) const
+    {
+        std::size_t node = 0;
+        while (m_nodes[node].kind != Node::trapezoid)
+        {
+            const Node &nd = m_nodes[node];
+            if (nd.kind == Node::point) {
+                node = xy_less(s.p, nd.a) ? nd.left : nd.right;
+                continue;
+            }
+            // From the start of that segment, which way s goes.
+            double turn = predicates::orient2d(nd.a, nd.b, s.p);
+            if (turn == 0) turn = predicates::orient2d(nd.a, nd.b, s.q);
+            node = turn > 0 ? nd.right : nd.left;
+        }
+        return m_nodes[node].index;
+    }
+
+    /**
+     * Adds segment si to the map: the trapezoids it crosses are replaced by those above and below it, and
+     * those left of its first point and right of its last one.
+     */
+    void add_segment(std::size_t si)
+    {
+        const Segment s = m_segments[si];
+
+        // The trapezoids crossed, from left to right: through the lower part of the right wall if its point
+        // is above s, the upper part otherwise.
+        std::vector<std::size_t> crossed{find_start(s)};
+        while (xy_less(m_trapezoids[crossed.back()].right, s.q))
+        {
+            const Trapezoid &t = m_trapezoids[crossed.back()];
+            crossed.push_back(above(s, t.right) ? t.lower_right : t.upper_right);
+        }
+        std::vector<Trapezoid> old;
+        for (std::size_t t : crossed) old.push_back(m_trapezoids[t]);
+        std::size_t k = crossed.size() - 1;
+
+        std::size_t left = same(s.p, old[0].left) ? none : add_trapezoid(old[0].left, s.p, old[0].top, old[0].bottom);
+        std::size_t right = same(s.q, old[k].right) ? none : add_trapezoid(s.q, old[k].right, old[k].top, old[k].bottom);
+
+        // Above and below s in each crossed trapezoid: a new one where a wall stays on that side of s, the
+        // same one as the previous trapezoid otherwise.
+        std::vector<std::size_t> up(k + 1), down(k + 1);
+        for (std::size_t j = 0; j <= k; ++j)
+        {
+            Point wall = j == 0 ? s.p : old[j - 1].right;
+            bool wall_above = j > 0 && above(s, wall);
+            up[j] = j == 0 || wall_above ? add_trapezoid(wall, s.q, old[j].top, si) : up[j - 1];
+            down[j] = j == 0 || !wall_above ? add_trapezoid(wall, s.q, si, old[j].bottom) : down[j - 1];
+            if (j > 0) m_trapezoids[wall_above ? up[j - 1] : down[j - 1]].right = wall;
+        }
+
+        // Neighbours across the walls through the ends of s.
+        auto &tr = m_trapezoids;
+        if (left != none) {
+            tr[left].upper_left = old[0].upper_left;
+            tr[left].lower_left = old[0].lower_left;
+            relink(old[0].upper_left, crossed[0], left);
+            relink(old[0].lower_left, crossed[0], left);
+            tr[left].upper_right = up[0];
+            tr[left].lower_right = down[0];
+            tr[up[0]].upper_left = tr[down[0]].lower_left = left;
+        } else {
+            tr[up[0]].upper_left = old[0].upper_left;
+            tr[down[0]].lower_left = old[0].lower_left;
+            relink(old[0].upper_left, crossed[0], up[0]);
+            relink(old[0].lower_left, crossed[0], down[0]);
+        }
+        if (right != none) {
+            tr[right].upper_right = old[k].upper_right;
+            tr[right].lower_right = old[k].lower_right;
+            relink(old[k].upper_right, crossed[k], right);
+            relink(old[k].lower_right, crossed[k], right);
+            tr[right].upper_left = up[k];
+            tr[right].lower_left = down[k];
+            tr[up[k]].upper_right = tr[down[k]].lower_right = right;
+        } else {
+            tr[up[k]].upper_right = old[k].upper_right;
+            tr[down[k]].lower_right = old[k].lower_right;
+            relink(old[k].upper_right, crossed[k], up[k]);
+            relink(old[k].lower_right, crossed[k], down[k]);
+        }
+
+        // Across the walls in between: each one is now cut by s, and the part on the far side of s is gone.
+        for (std::size_t j = 1; j <= k; ++j)
+        {
+            if (above(s, old[j - 1].right)) {
+                tr[up[j - 1]].upper_right = old[j - 1].upper_right;
+                relink(old[j - 1].upper_right, crossed[j - 1], up[j - 1]);
+                tr[up[j - 1]].lower_right = up[j];
+                tr[up[j]].upper_left = old[j].upper_left;
+                relink(old[j].upper_left, crossed[j], up[j]);
+                tr[up[j]].lower_left = up[j - 1];
+            } else {
+                tr[down[j - 1]].lower_right = old[j - 1].lower_right;
+                relink(old[j - 1].lower_right, crossed[j - 1], down[j - 1]);
+                tr[down[j - 1]].upper_right = down[j];
+                tr[down[j]].lower_left = old[j].lower_left;
+                relink(old[j].lower_left, crossed[j], down[j]);
+                tr[down[j]].upper_left = down[j - 1];
+            }
+        }
+
+        // The leaves of the crossed trapezoids become tests.
+        for (std::size_t j = 0; j <= k; ++j)
+        {
+            Node node{Node::segment, s.p, s.q, si, tr[down[j]].leaf, tr[up[j]].leaf};
+            if (j == k && right != none) {
+                node = Node{Node::point, s.q, s.q, 0, add_node(node), tr[right].leaf};
+            }
+            if (j == 0 && left != none) {
+                node = Node{Node::point, s.p, s.p, 0, tr[left].leaf, add_node(node)};
+            }
+            m_nodes[old[j].leaf] = node;
+        }
+    }
+
+    Location locate_map(Point q) const
+    {
+        std::size_t node = 0;
+        while (m_nodes[node].kind != Node::trapezoid)
+        {
+            const Node &nd = m_nodes[node];
+            if (nd.kind == Node::point) {
+                if (same(q, nd.a)) return Location::boundary;
+                node = xy_less(q, nd.a) ? nd.left : nd.right;
+                continue;
+            }
+            double turn = predicates::orient2d(nd.a, nd.b, q);
+            if (turn == 0) return Location::boundary;
+            node = turn > 0 ? nd.right : nd.left;
+        }
+        // A flat polygon has no inside.
+        std::size_t top = m_nodes[node].index;
+        bool inside = m_segments.size() > 1 && top != none && !m_segments[top].inside_above;
+        return inside ? Location::inside : Location::outside;
+    }
+
+    /**
+     * Calls fn(order, count) for blocks of consecutive queries in sorted order, over the threads.
+     */
+    template <class Fn>
+    void for_each_block(const PointSet &queries, unsigned threads, Fn &&fn) const
+    {
+        struct KeyedIndex
+        {
+            std::uint64_t key;
+            std::size_t index;
+        };
+
+        // Ascending keys of doubles: the reverse of descending_key.
+        std::vector<KeyedIndex> keyed(queries.size());
+        for (std::size_t i = 0; i < queries.size(); ++i)
+        {
+            Point q = queries[i];
+            double key = q.x;
+            if (is_fan()) {
+                // Pseudo-angle, as simple_polygon_v4.
+                double dx = q.x - m_pivot.x;
+                double dy = q.y - m_pivot.y;
+                double sum = std::abs(dy) - dx;
+                key = sum > 0 ? dy / sum : 1.0;
+            }
+            keyed[i] = {~problem2::descending_key(key), i};
+        }
+        radix_sort(keyed, [](const KeyedIndex &k) { return k.key; }, threads);
+
+        std::vector<std::size_t> order(queries.size());
+        for (std::size_t i = 0; i < keyed.size(); ++i) order[i] = keyed[i].index;
+        parallel_for((queries.size() + block_size - 1) / block_size, [&](std::size_t b) {
+            std::size_t first = b * block_size;
+            fn(order.data() + first, std::min(block_size, queries.size() - first));
+        }, threads);
+    }
+
+    PointSet m_polygon;
+
+    // Fan.
+    Point m_pivot;
+    std::vector<Ray> m_rays; // In order of angle.
+
+    // Trapezoidal map.
+    std::vector<Segment> m_segments;
+    std::vector<Trapezoid> m_trapezoids; // While building; those replaced are left, unused.
+    std::vector<Node> m_nodes; // The root first.
+};
+
+#endif //UNTITLED_POINT_LOCATION_H
@@ -0,0 +1,21 @@
+//
+// Created by bruno on 21/01/18.
+//
+
+#include <cstring>
+#include <iostream>
+
+#include "pointset_io.h"
+
+// Converts a text point file ("(x,y)" per line) to a binary point file.
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0] << " <points.txt> <points.pset> [--sort-x]\n";
+        return 1;
+    }
+
+    bool sort_by_x = argc > 3 && std::strcmp(argv[3], "--sort-x") == 0;
+    convert_point_file(argv[1], argv[2], sort_by_x);
+}
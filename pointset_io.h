@@ -0,0 +1,238 @@
+//
+// Created by bruno on 20/01/18.
+//
+
+#ifndef UNTITLED_POINTSET_IO_H
+#define UNTITLED_POINTSET_IO_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "parallel.h"
+
+/**
+ * Read-only memory mapping of a whole file.
+ */
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st{};
+        if (fd < 0 || ::fstat(fd, &st) != 0) {
+            std::cerr << "cannot open \"" << path << "\": " << std::strerror(errno) << ".\n";
+            std::abort();
+        }
+
+        m_size = static_cast<std::size_t>(st.st_size);
+        if (m_size > 0) {
+            void *data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (data == MAP_FAILED) {
+                std::cerr << "cannot map \"" << path << "\": " << std::strerror(errno) << ".\n";
+                std::abort();
+            }
+            m_data = static_cast<const char *>(data);
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (m_data) ::munmap(const_cast<char *>(m_data), m_size);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator =(const MappedFile &) = delete;
+
+    const char *data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+
+private:
+    const char *m_data = nullptr;
+    std::size_t m_size = 0;
+};
+
+/**
+ * Parses text holding one "(x,y)" point per line, as typed into ask_pointset(), and like it
+ * stops at the first line which doesn't hold a point.
+ * The text is split into chunks of whole lines which are parsed in parallel, straight into their
+ * slot of the result: no copies of the text and a single allocation for the points.
+ */
+inline PointSet parse_pointset(const char *data, std::size_t size, unsigned threads = hardware_threads())
+{
+    const char *end = data + size;
+
+    // Chunks of at least 1MB, starting at the beginning of a line.
+    std::size_t chunks = std::max<std::size_t>(1, std::min<std::size_t>(threads, size >> 20));
+    std::vector<const char *> bounds(chunks + 1, end);
+    bounds[0] = data;
+    for (std::size_t c = 1; c < chunks; ++c)
+    {
+        const char *nl = static_cast<const char *>(std::memchr(data + c * size / chunks, '\n', end - (data + c * size / chunks)));
+        bounds[c] = std::max(bounds[c - 1], nl ? nl + 1 : end);
+    }
+
+    auto lines_in = [](const char *first, const char *last) {
+        std::size_t lines = std::count(first, last, '\n');
+        return lines + (first != last && last[-1] != '\n');
+    };
+
+    // offsets[c] is the index of the first point of chunk c.
+    std::vector<std::size_t> offsets(chunks + 1, 0);
+    parallel_for(chunks, [&](std::size_t c) {
+        offsets[c + 1] = lines_in(bounds[c], bounds[c + 1]);
+    }, threads);
+    for (std::size_t c = 0; c < chunks; ++c) offsets[c + 1] += offsets[c];
+
+    PointSet ps(offsets[chunks]);
+    std::vector<std::size_t> parsed(chunks, 0);
+    std::vector<char> failed(chunks, 0);
+
+    parallel_for(chunks, [&](std::size_t c) {
+        Point *out = ps.data() + offsets[c];
+        for (const char *line = bounds[c], *last = bounds[c + 1]; line != last;)
+        {
+            const char *nl = static_cast<const char *>(std::memchr(line, '\n', last - line));
+            const char *line_end = nl ? nl : last;
+
+            if (!parse_point(line, line_end, out[parsed[c]])) {
+                failed[c] = 1;
+                return;
+            }
+            ++parsed[c];
+            line = nl ? nl + 1 : last;
+        }
+    }, threads);
+
+    auto first_failed = std::find(failed.begin(), failed.end(), 1);
+    if (first_failed != failed.end()) {
+        std::size_t c = first_failed - failed.begin();
+        ps.resize(offsets[c] + parsed[c]);
+    }
+    return ps;
+}
+
+/**
+ * Loads a file in the format of parse_pointset, through a memory mapping.
+ */
+inline PointSet load_pointset(const std::string &path, unsigned threads = hardware_threads())
+{
+    MappedFile file(path);
+    return parse_pointset(file.data(), file.size(), threads);
+}
+
+// Binary point files: a PointFileHeader, followed by the x-coords of all the points, then by
+// their y-coords (native doubles). Mapped in memory, they are used in place through a PointView,
+// and several processes share the same page-cached copy.
+
+struct PointFileHeader
+{
+    static constexpr char magic_bytes[4] = {'P', 'S', 'E', 'T'};
+    static constexpr std::uint32_t current_version = 1;
+    static constexpr std::uint64_t sorted_by_x = 1; // flag
+
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t count;
+    std::uint64_t flags;
+};
+
+/**
+ * Whether the file starts like a binary point file.
+ */
+inline bool is_point_file(const std::string &path)
+{
+    PointFileHeader header{};
+    std::ifstream in(path, std::ios::binary);
+    return in.read(reinterpret_cast<char *>(&header), sizeof(header)) &&
+           std::equal(header.magic, header.magic + 4, PointFileHeader::magic_bytes);
+}
+
+/**
+ * A binary point file mapped in memory. The points are valid as long as the object lives.
+ */
+class MappedPointSet
+{
+public:
+    explicit MappedPointSet(const std::string &path) : m_file(path)
+    {
+        if (m_file.size() < sizeof(PointFileHeader)) {
+            invalid(path);
+        }
+
+        // The count is checked against the size before being multiplied, which could overflow.
+        std::memcpy(&m_header, m_file.data(), sizeof(m_header));
+        std::size_t max_count = (m_file.size() - sizeof(PointFileHeader)) / (2 * sizeof(double));
+        if (!std::equal(m_header.magic, m_header.magic + 4, PointFileHeader::magic_bytes) ||
+            m_header.version != PointFileHeader::current_version || m_header.count > max_count ||
+            m_file.size() != sizeof(PointFileHeader) + 2 * m_header.count * sizeof(double)) {
+            invalid(path);
+        }
+    }
+
+    PointView view() const
+    {
+        auto xs = reinterpret_cast<const double *>(m_file.data() + sizeof(PointFileHeader));
+        return {xs, xs + m_header.count, m_header.count, (m_header.flags & PointFileHeader::sorted_by_x) != 0};
+    }
+
+private:
+    [[noreturn]] static void invalid(const std::string &path)
+    {
+        std::cerr << "\"" << path << "\" is not a valid point file.\n";
+        std::abort();
+    }
+
+    MappedFile m_file;
+    PointFileHeader m_header;
+};
+
+/**
+ * Writes ps as a binary point file, first sorting it on the x-coord if requested.
+ */
+inline void save_point_file(const std::string &path, PointSet ps, bool sort_by_x)
+{
+    if (sort_by_x) {
+        std::sort(ps.begin(), ps.end(), [](Point a, Point b) { return a.x < b.x || (a.x == b.x && a.y < b.y); });
+    }
+
+    PointFileHeader header{};
+    std::copy(PointFileHeader::magic_bytes, PointFileHeader::magic_bytes + 4, header.magic);
+    header.version = PointFileHeader::current_version;
+    header.count = ps.size();
+    header.flags = sort_by_x ? PointFileHeader::sorted_by_x : 0;
+
+    PointColumns columns(ps);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(columns.x.data()), columns.size() * sizeof(double));
+    out.write(reinterpret_cast<const char *>(columns.y.data()), columns.size() * sizeof(double));
+    if (!out) {
+        std::cerr << "cannot write \"" << path << "\".\n";
+        std::abort();
+    }
+}
+
+/**
+ * Converts a text point file (see parse_pointset) to a binary point file.
+ */
+inline void convert_point_file(const std::string &text_path, const std::string &binary_path, bool sort_by_x)
+{
+    save_point_file(binary_path, load_pointset(text_path), sort_by_x);
+}
+
+#endif //UNTITLED_POINTSET_IO_H
@@ -0,0 +1,283 @@
+//
+// Created by bruno on 20/01/18.
+//
+
+#ifndef UNTITLED_PREDICATES_H
+#define UNTITLED_PREDICATES_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "common.h"
+#include "instrument.h"
+
+// Robust geometric predicates (after Shewchuk).
+// A predicate is the sign of a polynomial in the coordinates (eg. a cross product). In doubles the
+// result is off by a rounding error, and its sign can be wrong when it is close to 0: points found
+// collinear when they aren't, or on the wrong side of a line.
+// - Filter: rounding errors are bounded by a constant times the magnitude of the terms. If the computed
+//   value is further from 0 than that, its sign is right: the common case, at the cost of a few operations.
+// - Otherwise the polynomial is evaluated again exactly, with expansions: sums of doubles which don't
+//   overlap. A product of doubles is exactly the sum of two doubles (fma), as is a sum of two doubles.
+// The predicates return a value with the sign of the exact result, close to it.
+
+namespace predicates {
+
+// The exact evaluations are rare: keep them out of line, so the filters stay small enough to inline.
+#if defined(__GNUC__)
+#define PREDICATES_NOINLINE __attribute__((noinline))
+#else
+#define PREDICATES_NOINLINE
+#endif
+
+constexpr double epsilon = std::numeric_limits<double>::epsilon() / 2; // Unit roundoff, 2^-53.
+constexpr double cross_bound = (3 + 16 * epsilon) * epsilon;
+constexpr double incircle_bound = (10 + 96 * epsilon) * epsilon;
+
+/**
+ * Bound on the error of cross2d for coordinates whose absolute values are at most max_abs.
+ * Holds for all such inputs at once, so a batch of them can share one check.
+ */
+constexpr double cross_static_bound(double max_abs)
+{
+    // The differences are at most 2 * max_abs (plus rounding), their products 4 * max_abs^2.
+    return cross_bound * 8 * max_abs * max_abs * (1 + 4 * epsilon);
+}
+
+/**
+ * Exact sum of doubles: the components are sorted by magnitude and don't overlap,
+ * so the sign of the sum is the sign of the last one.
+ */
+class Expansion
+{
+public:
+    Expansion() = default;
+    Expansion(double v)
+    {
+        if (v != 0) m_components.push_back(v);
+    }
+
+    static void two_sum(double a, double b, double &sum, double &err)
+    {
+        sum = a + b;
+        double bv = sum - a;
+        double av = sum - bv;
+        err = (a - av) + (b - bv);
+    }
+
+    static void two_product(double a, double b, double &product, double &err)
+    {
+        product = a * b;
+        err = std::fma(a, b, -product);
+    }
+
+    /**
+     * Adds b (Shewchuk's grow-expansion, dropping zeros).
+     */
+    Expansion &operator+=(double b)
+    {
+        std::size_t out = 0;
+        for (double c : m_components)
+        {
+            double sum, err;
+            two_sum(b, c, sum, err);
+            b = sum;
+            if (err != 0) m_components[out++] = err;
+        }
+        m_components.resize(out);
+        if (b != 0) m_components.push_back(b);
+        return *this;
+    }
+
+    Expansion &operator+=(const Expansion &e)
+    {
+        for (double c : e.m_components) *this += c;
+        return *this;
+    }
+
+    friend Expansion operator+(Expansion a, const Expansion &b) { return a += b; }
+
+    friend Expansion operator-(Expansion a, const Expansion &b)
+    {
+        for (double c : b.m_components) a += -c;
+        return a;
+    }
+
+    friend Expansion operator*(const Expansion &a, const Expansion &b)
+    {
+        Expansion res;
+        for (double ca : a.m_components)
+        {
+            for (double cb : b.m_components)
+            {
+                double product, err;
+                two_product(ca, cb, product, err);
+                res += err;
+                res += product;
+            }
+        }
+        return res;
+    }
+
+    /**
+     * Approximation of the sum, with its exact sign.
+     */
+    double estimate() const
+    {
+        return m_components.empty() ? 0 : m_components.back();
+    }
+
+private:
+    std::vector<double> m_components;
+};
+
+PREDICATES_NOINLINE inline double cross2d_exact(Point a1, Point a2, Point b1, Point b2)
+{
+    INSTRUMENT_COUNT(exact_predicate_calls, 1);
+    Expansion dax = Expansion(a2.x) - a1.x, day = Expansion(a2.y) - a1.y;
+    Expansion dbx = Expansion(b2.x) - b1.x, dby = Expansion(b2.y) - b1.y;
+    return (dax * dby - day * dbx).estimate();
+}
+
+/**
+ * Cross product of a2 - a1 and b2 - b1, with its exact sign: positive if b turns left of a.
+ */
+inline double cross2d(Point a1, Point a2, Point b1, Point b2)
+{
+    INSTRUMENT_COUNT(predicate_calls, 1);
+    double left = (a2.x - a1.x) * (b2.y - b1.y);
+    double right = (a2.y - a1.y) * (b2.x - b1.x);
+    double det = left - right;
+    if (std::abs(det) > cross_bound * (std::abs(left) + std::abs(right))) {
+        return det;
+    }
+    return cross2d_exact(a1, a2, b1, b2);
+}
+
+/**
+ * Positive if c is on the left of a->b (a, b, c counter-clockwise), negative on the right, 0 if collinear.
+ */
+inline double orient2d(Point a, Point b, Point c)
+{
+    return cross2d(a, b, a, c);
+}
+
+PREDICATES_NOINLINE inline double incircle_exact(Point a, Point b, Point c, Point d)
+{
+    INSTRUMENT_COUNT(exact_predicate_calls, 1);
+    Expansion adx = Expansion(a.x) - d.x, ady = Expansion(a.y) - d.y;
+    Expansion bdx = Expansion(b.x) - d.x, bdy = Expansion(b.y) - d.y;
+    Expansion cdx = Expansion(c.x) - d.x, cdy = Expansion(c.y) - d.y;
+
+    Expansion alift = adx * adx + ady * ady;
+    Expansion blift = bdx * bdx + bdy * bdy;
+    Expansion clift = cdx * cdx + cdy * cdy;
+
+    return (alift * (bdx * cdy - cdx * bdy) + blift * (cdx * ady - adx * cdy) + clift * (adx * bdy - bdx * ady)).estimate();
+}
+
+/**
+ * For a, b, c counter-clockwise: positive if d is inside the circle through them, negative outside,
+ * 0 on it.
+ */
+inline double incircle(Point a, Point b, Point c, Point d)
+{
+    INSTRUMENT_COUNT(predicate_calls, 1);
+    double adx = a.x - d.x, ady = a.y - d.y;
+    double bdx = b.x - d.x, bdy = b.y - d.y;
+    double cdx = c.x - d.x, cdy = c.y - d.y;
+
+    double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+    double cdxady = cdx * ady, adxcdy = adx * cdy;
+    double adxbdy = adx * bdy, bdxady = bdx * ady;
+    double alift = adx * adx + ady * ady;
+    double blift = bdx * bdx + bdy * bdy;
+    double clift = cdx * cdx + cdy * cdy;
+
+    double det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy) + clift * (adxbdy - bdxady);
+    double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * alift
+                     + (std::abs(cdxady) + std::abs(adxcdy)) * blift
+                     + (std::abs(adxbdy) + std::abs(bdxady)) * clift;
+    if (std::abs(det) > incircle_bound * permanent) {
+        return det;
+    }
+    return incircle_exact(a, b, c, d);
+}
+
+// Other coordinate types, picked at compile time by Kernel<T>:
+// - float: converted to double (exactly), where the filtered predicates above give the exact sign.
+//   Half the memory of double for the points.
+// - std::int64_t, for coordinates within +-2^60: differences, products and their sums all fit in 128-bit
+//   integers, so the plain computation is exact, with no filter. Cheaper than the double path.
+
+__extension__ typedef __int128 int128;
+
+template <class T>
+struct Kernel;
+
+template <>
+struct Kernel<double>
+{
+    using wide = double;                  // Type of cross products and squared distances.
+    static constexpr bool exact = false;  // Whether plain arithmetic in wide is exact.
+    static constexpr wide infinite_distance = std::numeric_limits<double>::max();
+};
+
+template <>
+struct Kernel<float>
+{
+    using wide = double;
+    static constexpr bool exact = false;
+    static constexpr wide infinite_distance = std::numeric_limits<double>::max();
+};
+
+template <>
+struct Kernel<std::int64_t>
+{
+    using wide = int128;
+    static constexpr bool exact = true;
+    static constexpr std::int64_t max_abs = std::int64_t(1) << 60;
+    // Above any squared distance (< 2^123), and still 4 times that fits.
+    static constexpr wide infinite_distance = wide(1) << 124;
+};
+
+/**
+ * Same as cross2d on doubles, for the other coordinate types.
+ */
+template <class T>
+typename Kernel<T>::wide cross2d(BasicPoint<T> a1, BasicPoint<T> a2, BasicPoint<T> b1, BasicPoint<T> b2)
+{
+    using W = typename Kernel<T>::wide;
+    if constexpr (Kernel<T>::exact) {
+        INSTRUMENT_COUNT(predicate_calls, 1);
+        return (W(a2.x) - a1.x) * (W(b2.y) - b1.y) - (W(a2.y) - a1.y) * (W(b2.x) - b1.x);
+    } else {
+        auto to_double = [](BasicPoint<T> p) { return Point{double(p.x), double(p.y)}; };
+        return cross2d(to_double(a1), to_double(a2), to_double(b1), to_double(b2));
+    }
+}
+
+template <class T>
+typename Kernel<T>::wide orient2d(BasicPoint<T> a, BasicPoint<T> b, BasicPoint<T> c)
+{
+    return cross2d(a, b, a, c);
+}
+
+/**
+ * Squared distance between a and b, exact for the exact kernels.
+ */
+template <class T>
+typename Kernel<T>::wide squared_distance(BasicPoint<T> a, BasicPoint<T> b)
+{
+    using W = typename Kernel<T>::wide;
+    W dx = W(a.x) - W(b.x);
+    W dy = W(a.y) - W(b.y);
+    return dx * dx + dy * dy;
+}
+
+} // end namespace predicates
+
+#endif //UNTITLED_PREDICATES_H
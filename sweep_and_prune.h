@@ -0,0 +1,192 @@
+//
+// Created by bruno on 27/01/18.
+//
+
+#ifndef UNTITLED_SWEEP_AND_PRUNE_H
+#define UNTITLED_SWEEP_AND_PRUNE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+#include "instrument.h"
+#include "lecture1.h"
+
+// Broad phase for many moving segments, frame after frame: which pairs intersect (problem 1), without
+// testing every pair.
+// - Sweep and prune: the min and max x-coords of the bounding boxes, sorted, are swept from left to right.
+//   A box is open between its two ends; when one opens, the others open at the time overlap it on x, and
+//   are the only candidates. Those whose boxes overlap on y too are confirmed with on_opposite_sides.
+// - The sorted ends are kept from one frame to the next. After the segments move, they are sorted again by
+//   insertion sort: if they moved little, the order barely changed, and that costs O(n + swaps), not
+//   O(n log n). The sweep is O(n + pairs overlapping on x).
+
+class SweepAndPrune
+{
+public:
+    explicit SweepAndPrune(std::vector<Line> segments = {}) : m_segments(std::move(segments))
+    {
+        m_boxes.reserve(m_segments.size());
+        m_ends.reserve(2 * m_segments.size());
+        for (std::size_t i = 0; i < m_segments.size(); ++i)
+        {
+            m_boxes.emplace_back(m_segments[i]);
+            m_ends.push_back({m_boxes[i].min_x, end_of(i, false)});
+            m_ends.push_back({m_boxes[i].max_x, end_of(i, true)});
+        }
+        INSTRUMENT_PHASE(sort);
+        std::sort(m_ends.begin(), m_ends.end(), less);
+    }
+
+    std::size_t size() const { return m_segments.size(); }
+
+    const Line &segment(std::size_t i) const { return m_segments[i]; }
+
+    /**
+     * Moves segment i to l.
+     */
+    void move(std::size_t i, Line l)
+    {
+        m_segments[i] = l;
+        m_boxes[i] = BoundingBox{l};
+        m_moved = true;
+    }
+
+    /**
+     * Moves all the segments at once: segments[i] is the new position of segment i.
+     */
+    void move(const std::vector<Line> &segments)
+    {
+        for (std::size_t i = 0; i < segments.size(); ++i) move(i, segments[i]);
+    }
+
+    /**
+     * Adds a segment, with the next index.
+     */
+    void add(Line l)
+    {
+        std::size_t i = m_segments.size();
+        m_segments.push_back(l);
+        m_boxes.emplace_back(l);
+        m_ends.push_back({m_boxes[i].min_x, end_of(i, false)});
+        m_ends.push_back({m_boxes[i].max_x, end_of(i, true)});
+        m_moved = true;
+    }
+
+    /**
+     * Swaps done by the insertion sort of the last sweep: a measure of how much the order changed.
+     */
+    std::size_t last_swaps() const { return m_swaps; }
+
+    /**
+     * Calls fn(i, j), i < j, for every pair of segments whose bounding boxes overlap (or touch).
+     */
+    template <class Fn>
+    void for_each_candidate(Fn &&fn)
+    {
+        update_order();
+
+        INSTRUMENT_PHASE(scan);
+        // Indices of the open boxes, and the position of each one in it.
+        m_open.clear();
+        m_open_pos.resize(m_segments.size());
+        for (const End &e : m_ends)
+        {
+            std::size_t i = e.item / 2;
+            if (e.item % 2) {
+                std::size_t pos = m_open_pos[i];
+                m_open[pos] = m_open.back();
+                m_open_pos[m_open[pos]] = pos;
+                m_open.pop_back();
+                continue;
+            }
+            const BoundingBox &bb = m_boxes[i];
+            for (std::size_t j : m_open)
+            {
+                // Overlap on x already: only y is left.
+                if (bb.max_y >= m_boxes[j].min_y && bb.min_y <= m_boxes[j].max_y) {
+                    fn(std::min(i, j), std::max(i, j));
+                }
+            }
+            m_open_pos[i] = m_open.size();
+            m_open.push_back(i);
+        }
+    }
+
+    /**
+     * Calls fn(i, j), i < j, for every pair of intersecting segments: the same pairs as intersect().
+     */
+    template <class Fn>
+    void for_each_intersection(Fn &&fn)
+    {
+        for_each_candidate([&](std::size_t i, std::size_t j) {
+            const Line &l1 = m_segments[i];
+            const Line &l2 = m_segments[j];
+            if (on_opposite_sides(l1.p1, l1.p2, l2) && on_opposite_sides(l2.p1, l2.p2, l1)) fn(i, j);
+        });
+    }
+
+    std::vector<std::pair<std::size_t, std::size_t>> intersections()
+    {
+        std::vector<std::pair<std::size_t, std::size_t>> res;
+        for_each_intersection([&](std::size_t i, std::size_t j) { res.emplace_back(i, j); });
+        return res;
+    }
+
+private:
+    /**
+     * One end of a box on x: item is twice the index of the segment, plus 1 for the max.
+     */
+    struct End
+    {
+        double x;
+        std::size_t item;
+    };
+
+    static std::size_t end_of(std::size_t i, bool max) { return 2 * i + max; }
+
+    // At the same x, boxes open before others close: touching boxes overlap.
+    static bool less(const End &e1, const End &e2)
+    {
+        return e1.x < e2.x || (e1.x == e2.x && e1.item % 2 < e2.item % 2);
+    }
+
+    /**
+     * Takes the new x-coords of the ends, and sorts them again from the previous order.
+     */
+    void update_order()
+    {
+        m_swaps = 0;
+        if (!m_moved) return;
+        m_moved = false;
+
+        INSTRUMENT_PHASE(sort);
+        for (End &e : m_ends)
+        {
+            const BoundingBox &bb = m_boxes[e.item / 2];
+            e.x = e.item % 2 ? bb.max_x : bb.min_x;
+        }
+        for (std::size_t k = 1; k < m_ends.size(); ++k)
+        {
+            End e = m_ends[k];
+            std::size_t pos = k;
+            for (; pos > 0 && less(e, m_ends[pos - 1]); --pos) m_ends[pos] = m_ends[pos - 1];
+            m_ends[pos] = e;
+            m_swaps += k - pos;
+        }
+        INSTRUMENT_COUNT(comparisons, m_ends.size() + m_swaps);
+    }
+
+    std::vector<Line> m_segments;
+    std::vector<BoundingBox> m_boxes;
+    std::vector<End> m_ends; // Sorted on x as of the last sweep.
+    bool m_moved = false;
+    std::size_t m_swaps = 0;
+
+    std::vector<std::size_t> m_open;
+    std::vector<std::size_t> m_open_pos;
+};
+
+#endif //UNTITLED_SWEEP_AND_PRUNE_H
@@ -0,0 +1,154 @@
+//
+// Created by bruno on 25/01/18.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+#include "kdtree.h"
+#include "lecture2.h"
+#include "parallel.h"
+#include "point_location.h"
+
+// Regression tests, each against a simpler implementation of the same thing. Run by ctest.
+// - A check that fails prints where, and the run goes on; the exit code is the number of failures.
+// - Inputs are generated from a fixed seed, and are large enough to go through the parallel paths.
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char *what)
+{
+    if (!ok) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+// Against std::stable_sort, with threads > 1 and n past the size where the items are split in chunks.
+// Keys are drawn from a few ranges so that some passes are skipped, and repeat so that stability matters.
+void test_radix_sort()
+{
+    std::mt19937_64 rng(1);
+    for (std::size_t n : {std::size_t(1) << 18, (std::size_t(1) << 20) + 3})
+    {
+        for (std::uint64_t range : {std::uint64_t(1) << 20, std::uint64_t(1) << 40, ~std::uint64_t(0)})
+        {
+            std::vector<std::pair<std::uint64_t, std::size_t>> items(n);
+            for (std::size_t i = 0; i < n; ++i) items[i] = {rng() % range, i};
+            std::vector<std::pair<std::uint64_t, std::size_t>> expected = items;
+            std::stable_sort(expected.begin(), expected.end(),
+                             [](const auto &a, const auto &b) { return a.first < b.first; });
+
+            for (unsigned threads : {1u, 3u, 8u})
+            {
+                std::vector<std::pair<std::uint64_t, std::size_t>> sorted = items;
+                radix_sort(sorted, [](const auto &item) { return item.first; }, threads);
+                check(sorted == expected, "radix_sort matches std::stable_sort");
+            }
+        }
+    }
+}
+
+// Batched queries over 8 threads against one query at a time, on a fan (the polygon of simple_polygon_v4)
+// and on a star around the origin, which isn't one and goes through the trapezoidal map. Queries are
+// random, plus the vertices themselves.
+void test_locate()
+{
+    std::mt19937_64 rng(2);
+    std::uniform_real_distribution<double> u(-1, 1);
+
+    PointSet fan(1 << 12);
+    for (Point &p : fan) p = {u(rng), u(rng)};
+    problem2::simple_polygon_v4(fan);
+
+    PointSet star(1 << 12);
+    for (std::size_t i = 0; i < star.size(); ++i)
+    {
+        double angle = 2 * std::acos(-1.0) * i / star.size();
+        double radius = 0.2 + 0.8 * (u(rng) + 1) / 2;
+        star[i] = {radius * std::cos(angle), radius * std::sin(angle)};
+    }
+
+    for (const PointSet *polygon : {&fan, &star})
+    {
+        PolygonIndex index(*polygon);
+        check(index.is_fan() == (polygon == &fan), "the fan, and only it, is located as a fan");
+        PointSet queries(1 << 19);
+        for (Point &q : queries) q = {u(rng), u(rng)};
+        queries.insert(queries.end(), polygon->begin(), polygon->end());
+
+        std::vector<Location> expected(queries.size());
+        for (std::size_t i = 0; i < queries.size(); ++i) expected[i] = index.locate(queries[i]);
+        check(index.locate(queries, 8) == expected, "batched locate matches single locate, 8 threads");
+        check(index.locate(queries, 1) == expected, "batched locate matches single locate, 1 thread");
+    }
+}
+
+// Batched nearest and within over 8 threads against a linear scan, on a tree built over 8 threads that is big
+// enough to be built in parallel. Some points are repeated, so that there are ties: neighbours are compared
+// on their distances, and on the points they are at.
+void test_kdtree()
+{
+    std::mt19937_64 rng(3);
+    std::uniform_real_distribution<double> u(0, 1);
+    PointSet ps(1 << 16);
+    for (Point &p : ps) p = {u(rng), u(rng)};
+    for (std::size_t i = 0; i < ps.size(); i += 7) ps[i] = ps[rng() % ps.size()];
+    PointSet queries(1000);
+    for (Point &q : queries) q = {u(rng), u(rng)};
+    queries.insert(queries.end(), ps.begin(), ps.begin() + 100);
+
+    KdTree tree(ps, 8);
+    check(tree.size() == ps.size(), "KdTree has all the points");
+
+    const std::size_t k = 5;
+    const double r = 0.01;
+    std::vector<KdTree::Neighbor> nearest = tree.nearest(queries, k, 8);
+    KdTree::RadiusResult within = tree.within(queries, r, 8);
+    for (std::size_t q = 0; q < queries.size(); ++q)
+    {
+        std::vector<double> distances(ps.size());
+        std::vector<std::size_t> expected_within;
+        for (std::size_t i = 0; i < ps.size(); ++i)
+        {
+            double dx = ps[i].x - queries[q].x;
+            double dy = ps[i].y - queries[q].y;
+            distances[i] = dx * dx + dy * dy;
+            if (distances[i] <= r * r) expected_within.push_back(i);
+        }
+
+        std::vector<double> expected_nearest = distances;
+        std::partial_sort(expected_nearest.begin(), expected_nearest.begin() + k, expected_nearest.end());
+        bool ok = true;
+        for (std::size_t j = 0; j < k; ++j)
+        {
+            const KdTree::Neighbor &nb = nearest[q * k + j];
+            ok = ok && nb.squared_distance == expected_nearest[j] && distances[nb.index] == nb.squared_distance;
+        }
+        check(ok, "KdTree::nearest matches a linear scan");
+
+        std::vector<std::size_t> found(within.indices.begin() + within.offsets[q],
+                                       within.indices.begin() + within.offsets[q + 1]);
+        std::sort(found.begin(), found.end());
+        check(found == expected_within, "KdTree::within matches a linear scan");
+    }
+}
+
+} // namespace
+
+int main()
+{
+    test_radix_sort();
+    test_locate();
+    test_kdtree();
+    if (failures == 0) std::cerr << "All tests passed" << std::endl;
+    return failures;
+}